@@ -0,0 +1,83 @@
+/*
+ * analyzer-bench.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#include <chrono>
+#include <clocale>
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "analyzer.h"
+#include "options.h"
+#include "problem.h"
+
+namespace {
+
+namespace an = analysis;
+
+Options make_options(std::vector<std::string> flags)
+{
+	flags.insert(flags.begin(), { "quiz", "bench.qz" });
+	std::vector<char*> argv;
+	for (std::string& f: flags)
+		argv.push_back(&f[0]);
+
+	Options options;
+	options.parse_arguments(static_cast<int>(argv.size()), argv.data());
+	return options;
+}
+
+// prints checks of the answer per second
+void measure(const std::string& name, an::Analyzer& analyzer, const Problem& problem,
+	const an::AnswerLines& answer, const Options& options)
+{
+	const int ROUNDS = 200000;
+	std::pmr::unsynchronized_pool_resource arena;
+	volatile size_t sink = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < ROUNDS; ++i)
+		sink = sink + analyzer.check(problem, answer, options, &arena).errors.size();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	std::cout << name << ": " << static_cast<int>(ROUNDS / elapsed.count()) << " checks/s" << std::endl;
+}
+
+void check_benchmarks(const std::string& title, const Problem& problem, const an::AnswerLines& answer)
+{
+	std::cout << "# " << title << std::endl;
+	an::Analyzer analyzer;
+	measure("default", analyzer, problem, answer, make_options({}));
+	measure("-c     ", analyzer, problem, answer, make_options({ "-c" }));
+	measure("-u     ", analyzer, problem, answer, make_options({ "-u" }));
+	measure("-cu    ", analyzer, problem, answer, make_options({ "-cu" }));
+	measure("-z     ", analyzer, problem, answer, make_options({ "-z" }));
+	measure("-zc    ", analyzer, problem, answer, make_options({ "-zc" }));
+	std::cout << std::endl;
+}
+
+} // namespace
+
+int main()
+{
+	setlocale(LC_ALL, "");
+
+	Problem phrase({ "Я бы хотел заказать столик на двоих" },
+		{ "I would like to {reserve|book} a table for two, please." },
+		utils::Language::UNKNOWN, utils::Language::UNKNOWN);
+	check_benchmarks("right answer", phrase, { "I would like to book a table for two, please." });
+	check_benchmarks("wrong answer", phrase, { "I would like to reserv a tabel for two please" });
+
+	Problem verbs({ "Verbs followed by a to-infinitive:" },
+		{ "advise to do, afford to do, agree to do,", "appear to do, arrange to do, ask to do" },
+		utils::Language::UNKNOWN, utils::Language::UNKNOWN);
+	check_benchmarks("two lines", verbs, { "advise to do, afford to do, Agree to do,", "appear to do, ask to do" });
+	return 0;
+}
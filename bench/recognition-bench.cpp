@@ -0,0 +1,127 @@
+/*
+ * recognition-bench.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "audio.h"
+#include "recognizer.h"
+
+// recognition of WAV files (PCM 16 bit mono) without a microphone:
+//   ./recognition-bench [-r] file.wav...
+// the reference transcript of file.wav is read from file.txt, if it exists;
+// -r reads the files in real time, as a microphone, to measure the latencies
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds(Clock::duration d)
+{
+	return std::chrono::duration<double>(d).count();
+}
+
+std::vector<std::string> words(const std::string& s)
+{
+	std::istringstream in(s);
+	return { std::istream_iterator<std::string>(in), std::istream_iterator<std::string>() };
+}
+
+// word error rate: edit distance of the words by the reference length
+double word_error_rate(const std::string& reference, const std::string& hypothesis)
+{
+	std::vector<std::string> r = words(reference), h = words(hypothesis);
+	std::vector<size_t> row(h.size() + 1);
+	for (size_t j = 0; j <= h.size(); ++j)
+		row[j] = j;
+
+	for (size_t i = 1; i <= r.size(); ++i) {
+		size_t diagonal = row[0];
+		row[0] = i;
+		for (size_t j = 1; j <= h.size(); ++j) {
+			size_t substitution = diagonal + (r[i - 1] == h[j - 1] ? 0 : 1);
+			diagonal = row[j];
+			row[j] = std::min({ row[j] + 1, row[j - 1] + 1, substitution });
+		}
+	}
+	return r.empty() ? 0 : static_cast<double>(row[h.size()]) / r.size();
+}
+
+std::string reference_of(const std::string& wav)
+{
+	std::ifstream in(wav.substr(0, wav.rfind('.')) + ".txt");
+	std::string line;
+	std::getline(in, line);
+	return line;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	bool realtime = false;
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "-r")
+			realtime = true;
+		else
+			files.push_back(arg);
+	}
+
+	if (files.empty()) {
+		std::cerr << "usage: recognition-bench [-r] file.wav..." << std::endl;
+		return 1;
+	}
+
+	auto start = Clock::now();
+	audio::Recognizer recognizer;
+	std::cout << "models loaded: " << seconds(Clock::now() - start) << " s" << std::endl;
+
+	double errors = 0;
+	size_t references = 0;
+	for (const std::string& file: files) {
+		audio::WavSource source(file, realtime);
+
+		Clock::time_point first_partial;
+		bool any_partial = false;
+		start = Clock::now();
+		std::string result = recognizer.recognize(source, [&](const std::string&, bool final) {
+			if (!final && !any_partial) {
+				first_partial = Clock::now();
+				any_partial = true;
+			}
+		});
+		double elapsed = seconds(Clock::now() - start);
+
+		std::cout << "# " << file << std::endl;
+		std::cout << "hypothesis: " << result << std::endl;
+		std::cout << "decoded in: " << elapsed << " s" << std::endl;
+		if (any_partial)
+			std::cout << "first partial: " << seconds(first_partial - start) << " s" << std::endl;
+
+		std::string reference = reference_of(file);
+		if (!reference.empty()) {
+			double wer = word_error_rate(reference, result);
+			std::cout << "WER: " << wer << std::endl;
+			errors += wer;
+			++references;
+		}
+	}
+
+	if (references != 0)
+		std::cout << std::endl << "mean WER: " << errors / references << std::endl;
+	return 0;
+}
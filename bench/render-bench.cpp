@@ -0,0 +1,149 @@
+/*
+ * render-bench.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#include <chrono>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+#include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "analyzer.h"
+#include "ncurces_screen.h"
+#include "options.h"
+#include "problem.h"
+
+// bytes written to a 120x40 xterm by the transitions of the quiz,
+// time of the transitions of a problem longer than the screen
+
+namespace {
+
+namespace an = analysis;
+
+struct Bytes
+{
+	uint64_t problem = 0, result = 0;
+};
+
+// terminal output to a pipe, the bytes are counted and discarded
+class Counter
+{
+public:
+	Counter() {
+		int fds[2];
+		if (pipe2(fds, O_CLOEXEC) != 0)
+			throw std::runtime_error("Counter: can't create a pipe");
+		in = fds[0];
+		fcntl(in, F_SETFL, O_NONBLOCK);
+		fcntl(fds[1], F_SETPIPE_SZ, 1 << 20);
+		out = fdopen(fds[1], "w");
+	}
+
+	~Counter() {
+		fclose(out);
+		close(in);
+	}
+
+	FILE* file() const { return out; }
+
+	uint64_t bytes() {
+		char buf[4096];
+		ssize_t n;
+		while ((n = read(in, buf, sizeof(buf))) > 0)
+			counted += static_cast<uint64_t>(n);
+		return counted;
+	}
+
+private:
+	int in;
+	FILE* out;
+	uint64_t counted = 0;
+};
+
+} // namespace
+
+int main()
+{
+	setlocale(LC_ALL, "");
+	setenv("TERM", "xterm-256color", 1);
+	setenv("LINES", "40", 1);
+	setenv("COLUMNS", "120", 1);
+
+	const int PROBLEMS = 50;
+	const int RECALL_LINES = 1000;
+	std::vector<Problem> problems;
+	for (int i = 0; i < PROBLEMS; ++i)
+		problems.emplace_back(std::list<std::string>{ "Verbs followed by a to-infinitive, " + std::to_string(i) },
+			std::list<std::string>{ "advise to do, afford to do, agree to do,", "appear to do, arrange to do, ask to do" },
+			utils::Language::EN, utils::Language::EN);
+
+	Options options;
+	an::Analyzer analyzer;
+	std::pmr::unsynchronized_pool_resource arena;
+	an::AnswerLines answer = { "advise to do, aford to do, agree to do,", "appear to do, arrange do, ask to do" };
+
+	// a recall problem longer than the screen, only its visible lines are drawn
+	std::list<std::string> recall;
+	for (int i = 0; i < RECALL_LINES; ++i)
+		recall.push_back("line " + std::to_string(i) + " of the recalled text");
+	Problem long_problem(recall, recall, utils::Language::EN, utils::Language::EN);
+	analyzer.prepare(long_problem, options);
+	an::AnswerLines long_answer(recall.begin(), recall.end());
+	auto long_verification = std::make_shared<const an::Verification>(
+		analyzer.check(long_problem, long_answer, options, &arena));
+	double long_seconds = 0;
+
+	Bytes bytes;
+	uint64_t started = 0;
+	Counter counter;
+	{
+		view::ncurses::NScreen screen(false, 4, counter.file());
+		started = counter.bytes();
+
+		Statistics statistics = { PROBLEMS, 0, 0, 1, 0, 0 };
+		for (int i = 0; i < PROBLEMS; ++i) {
+			analyzer.prepare(problems[i], options);
+
+			uint64_t before = counter.bytes();
+			statistics.left_problems = PROBLEMS - i;
+			screen.update_statistic(statistics);
+			screen.show_problem(problems[i]);
+			uint64_t shown = counter.bytes();
+
+			auto v = std::make_shared<const an::Verification>(analyzer.check(problems[i], answer, options, &arena));
+			++statistics.errors;
+			screen.update_statistic(statistics);
+			screen.show_result(v);
+			screen.show_message("Press space to play the question, F3 to skip it or another key to continue...");
+
+			bytes.problem += shown - before;
+			bytes.result += counter.bytes() - shown;
+		}
+
+		for (int i = 0; i < PROBLEMS; ++i) {
+			auto start = std::chrono::steady_clock::now();
+			screen.show_problem(long_problem);
+			screen.show_result(long_verification);
+			long_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			counter.bytes();
+		}
+	}
+
+	std::cout << "start: " << started << " bytes" << std::endl;
+	std::cout << "problem shown: " << bytes.problem / PROBLEMS << " bytes" << std::endl;
+	std::cout << "result shown: " << bytes.result / PROBLEMS << " bytes" << std::endl;
+	std::cout << RECALL_LINES << " lines problem and result shown: " << long_seconds * 1e6 / PROBLEMS << " us" << std::endl;
+	return 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * session-bench.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <clocale>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "headless_screen.h"
+#include "options.h"
+#include "problem.h"
+#include "session.h"
+
+// the whole quiz loop on the headless screen: time per problem, from the question
+// to the next one, and from a key of the answer to its frame
+
+namespace {
+
+namespace fs = std::filesystem;
+namespace hl = view::headless;
+
+Options make_options(std::vector<std::string> flags, const std::string& filename)
+{
+	flags.insert(flags.begin(), { "quiz", filename });
+	std::vector<char*> argv;
+	for (std::string& f: flags)
+		argv.push_back(&f[0]);
+
+	Options options;
+	options.parse_arguments(static_cast<int>(argv.size()), argv.data());
+	return options;
+}
+
+double percentile(std::vector<double> values, double p)
+{
+	if (values.empty())
+		return 0;
+	std::sort(values.begin(), values.end());
+	return values[static_cast<size_t>(p * (values.size() - 1))];
+}
+
+void measure(const std::string& name, const std::vector<std::string>& flags)
+{
+	const int PROBLEMS = 200;
+	const std::string SOLUTION = "advise to do, afford to do, agree to do";
+
+	// the same solution, so the script doesn't depend on the order of the problems
+	std::vector<std::shared_ptr<Problem>> problems;
+	for (int i = 0; i < PROBLEMS; ++i)
+		problems.push_back(std::make_shared<Problem>(
+			std::list<std::string>{ "Verbs followed by a to-infinitive, " + std::to_string(i) },
+			std::list<std::string>{ SOLUTION }, utils::Language::EN, utils::Language::EN));
+
+	fs::path file = fs::temp_directory_path() / "quiz-session-bench.qz";
+	Options options = make_options(flags, file.string());
+
+	hl::HeadlessScreen screen(false);
+	for (int i = 0; i < PROBLEMS; ++i) {
+		screen.type(SOLUTION);
+		screen.press(hl::Input::Key::F2);
+		screen.type("n");
+	}
+	screen.type("n");
+
+	session::StatisticSaver saver(file.string());
+	auto start = std::chrono::steady_clock::now();
+	session::run(problems, options, screen, saver, [](const std::string&, utils::Language) {}, 1);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	fs::remove(file.parent_path() / ("." + file.stem().string() + ".stat"));
+
+	const std::vector<double>& latencies = screen.key_latencies();
+	std::cout << name << ": " << elapsed.count() * 1e6 / PROBLEMS << " us/problem, "
+		<< screen.frames() / PROBLEMS << " frames/problem, key to frame "
+		<< percentile(latencies, 0.5) * 1e6 << " us p50, "
+		<< percentile(latencies, 0.99) * 1e6 << " us p99" << std::endl;
+}
+
+} // namespace
+
+int main()
+{
+	setlocale(LC_ALL, "");
+
+	measure("default", {});
+	measure("-a     ", { "-a" });
+	return 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * utils-bench.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <clocale>
+#include <cstdint>
+#include <cwctype>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include "utils.h"
+
+namespace {
+
+// byte at a time decoder of the Basic Multilingual Plane, the one used before
+std::u16string legacy_to_utf16(const std::string& in)
+{
+	std::u16string out;
+	const uint8_t* s = reinterpret_cast<const uint8_t*>(in.data());
+	while (*s) {
+		if (*s < 0x80) {
+			out.push_back(*s);
+			s += 1;
+		} else if ((*s >> 5) == 0x06) {
+			out.push_back(((*s << 6) & 0x7FF) + (*(s+1) & 0x3F));
+			s += 2;
+		} else if ((*s >> 4) == 0x0E) {
+			out.push_back(((*s << 12) & 0xFFFF) + ((*(s+1) << 6) & 0xFFF) + ((*(s+2)) & 0x3F));
+			s += 3;
+		} else
+			throw std::runtime_error("invalid utf8 symbol");
+	}
+
+	return out;
+}
+
+std::string legacy_to_utf8(const std::u16string& in)
+{
+	std::string out;
+	for (uint16_t wc: in) {
+		if (wc < 0x80)
+			out.push_back(static_cast<uint8_t>(wc));
+		else if (wc < 0x800) {
+			out.push_back(static_cast<uint8_t>((wc >> 6)          | 0xC0));
+			out.push_back(static_cast<uint8_t>((wc & 0x3F)        | 0x80));
+		} else {
+			out.push_back(static_cast<uint8_t>((wc >> 12)         | 0xE0));
+			out.push_back(static_cast<uint8_t>(((wc >> 6) & 0x3F) | 0x80));
+			out.push_back(static_cast<uint8_t>((wc & 0x3F)        | 0x80));
+		}
+	}
+	return out;
+}
+
+// counting of the symbols by ranges through a map, the one used before
+utils::Language legacy_what_language(const std::string& s)
+{
+	std::map<utils::Language, int> langs;
+	for (char16_t c: legacy_to_utf16(s)) {
+		if (c >= 0x0410 && c < 0x044F)
+			langs[utils::Language::RU]++;
+		else if (c >= 0x0041 && c < 0x007a)
+			langs[utils::Language::EN]++;
+		else
+			langs[utils::Language::UNKNOWN]++;
+	}
+
+	int max = 0;
+	utils::Language result = utils::Language::UNKNOWN;
+	for (auto p: langs) {
+		if (p.second > max) {
+			max = p.second;
+			result = p.first;
+		}
+	}
+	return result;
+}
+
+// prints throughput in MB/s of the utf8 text
+void measure(const std::string& name, const std::string& text, const std::function<size_t()>& f)
+{
+	const int ROUNDS = 2000;
+	volatile size_t sink = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < ROUNDS; ++i)
+		sink = sink + f();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	double mb = static_cast<double>(text.size()) * ROUNDS / (1024 * 1024);
+	std::cout << name << ": " << static_cast<int>(mb / elapsed.count()) << " MB/s" << std::endl;
+}
+
+void utf8_benchmarks(const std::string& title, const std::string& text)
+{
+	std::cout << "# " << title << ", " << text.size() << " bytes" << std::endl;
+	std::u16string utf16 = utils::to_utf16(text);
+
+	measure("legacy to_utf16  ", text, [&]() { return legacy_to_utf16(text).size(); });
+	measure("to_utf16         ", text, [&]() { return utils::to_utf16(text).size(); });
+	measure("legacy round trip", text, [&]() { return legacy_to_utf8(legacy_to_utf16(text)).size(); });
+	measure("round trip       ", text, [&]() { return utils::to_utf8(utils::to_utf16(text)).size(); });
+	measure("is_valid_utf8    ", text, [&]() { return static_cast<size_t>(utils::is_valid_utf8(text)); });
+	measure("utf8_length      ", text, [&]() { return utils::utf8_length(text); });
+	std::cout << std::endl;
+}
+
+void case_benchmarks(const std::string& title, const std::string& text)
+{
+	std::cout << "# case folding, " << title << ", " << text.size() << " bytes" << std::endl;
+
+	measure("legacy towlower  ", text, [&]() {
+		std::u16string s = legacy_to_utf16(text);
+		std::transform(s.begin(), s.end(), s.begin(), ::towlower);
+		return legacy_to_utf8(s).size();
+	});
+	measure("fold_case        ", text, [&]() {
+		std::string s = text;
+		utils::fold_case(s);
+		return s.size();
+	});
+	measure("normalize        ", text, [&]() {
+		std::string s = text;
+		utils::normalize(s);
+		return s.size();
+	});
+	std::cout << std::endl;
+}
+
+void language_benchmarks(const std::string& title, const std::string& text)
+{
+	std::cout << "# language, " << title << ", " << text.size() << " bytes" << std::endl;
+	measure("legacy what_language", text, [&]() { return static_cast<size_t>(legacy_what_language(text)); });
+	measure("what_language       ", text, [&]() { return static_cast<size_t>(utils::what_language(text)); });
+	std::cout << std::endl;
+}
+
+std::string repeat(const std::string& s, size_t times)
+{
+	std::string result;
+	for (size_t i = 0; i < times; ++i)
+		result.append(s);
+	return result;
+}
+
+} // namespace
+
+int main()
+{
+	utf8_benchmarks("english",
+		repeat("advise to do, afford to do, agree to do, appear to do, arrange to do, ", 1000));
+	utf8_benchmarks("russian",
+		repeat("советовать сделать, позволить себе, согласиться сделать, ", 1000));
+	utf8_benchmarks("mixed",
+		repeat("die Straße, the street, улица, ", 1000));
+
+	// the legacy functions depend on the locale
+	setlocale(LC_ALL, "C.UTF-8");
+	case_benchmarks("english", repeat("Advise To Do, Afford To Do, Agree To Do, ", 1000));
+	case_benchmarks("russian", repeat("Советовать Сделать, Позволить Себе, ", 1000));
+	case_benchmarks("german", repeat("Die STRAẞE, Über Den Fluss, ", 1000));
+
+	// a phrase as played by the voice and a whole text
+	language_benchmarks("phrase", "Ich möchte einen Tisch für zwei reservieren");
+	language_benchmarks("english", repeat("advise to do, afford to do, agree to do, appear to do, ", 100));
+	language_benchmarks("russian", repeat("советовать сделать, позволить себе, согласиться сделать, ", 100));
+	return 0;
+}
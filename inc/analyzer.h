@@ -12,8 +12,12 @@
 
 #include <list>
 #include <map>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
 #include <problem.h>
@@ -27,7 +31,8 @@ enum MARK {
 	INVALID_LINES_NUMBER = 0x1,
 	NOT_FULL_ANSWER      = 0x2,
 	REDUNDANT_ANSWER     = 0x4,
-	ERROR                = 0x8
+	ERROR                = 0x8,
+	NEAR_MISS            = 0x10  // words with typos in fuzzy mode, the answer is right
 };
 
 struct Token
@@ -41,49 +46,85 @@ struct Token
 	};
 
 	WHAT what;
-	std::u16string str;
-	size_t pos;
-
-	bool operator<(const Token& l) {
-		return str.compare(l.str);
-	}
+	std::string_view str; // utf8, view into the split text
+	size_t pos;           // in code points
 };
 
+using Tokens = std::pmr::vector<Token>;
+
 struct Error
 {
 	enum WHAT {
 		ERROR_TOKEN,
 		ERROR_SYMBOL,
 		MISSED,
-		REDUNDANT
+		REDUNDANT,
+		NEAR_MISS
 	};
 
 	WHAT what;
-	std::u16string str;
-	size_t pos; // position in string
+	size_t line;
+	size_t pos;          // position in the line, in code points
+	size_t offset, size; // the wrong text in the line, in bytes
+
+	// a missed token is shown as " ", the end of a not full answer as "..."
+	std::string_view text(std::string_view line) const {
+		if (what == MISSED)
+			return offset < line.size() ? " " : "...";
+		return line.substr(offset, size);
+	}
 };
 
+// lines of an answer, views into the buffer of the editor
+using AnswerLines = std::vector<std::string_view>;
+
 
+// memory of the containers is taken from the arena, which has to outlive the verification
 struct Verification
 {
-	std::list<std::string> answer;
-	std::list<std::string> solution;
-
-	int state;
-	// <line, Errors in line>
-	std::map<int, std::list<Error>> errors;
-
-	Verification(const Problem& p, const std::list<std::string>& a)
-		: answer(a)
-		, solution(p.solution())
-		, state(MARK::RIGHT)
+	// trimmed and normalized lines of the answer
+	std::pmr::vector<std::pmr::string> answer;
+	// total recall mode: wrong and missed phrases
+	std::pmr::vector<std::pmr::string> report;
+
+	int state = MARK::RIGHT;
+	// sorted by line
+	std::pmr::vector<Error> errors;
+
+	explicit Verification(std::pmr::memory_resource* arena = std::pmr::get_default_resource())
+		: answer(arena)
+		, report(arena)
+		, errors(arena)
 	{}
 
-	Verification() = default;
+	bool right() const { return (state & ~MARK::NEAR_MISS) == MARK::RIGHT; }
+
 	Verification(const Verification& v) = default;
 	Verification& operator= (const Verification& v) = default;
+	Verification(Verification&& v) = default;
+	Verification& operator= (Verification&& v) = default;
+};
+
+
+// answer of a problem for batch checking
+struct Submission
+{
+	const Problem* problem;
+	std::list<std::string> answer;
+};
+
+
+// phrases of a total recall solution, interned once per problem
+struct PhraseSet
+{
+	// sorted and unique, index in vector is the phrase id
+	std::vector<std::string> phrases;
+	// views into 'phrases', the set must not be moved after building
+	std::unordered_map<std::string_view, size_t> ids;
 };
 
+class Pattern;
+
 
 class Analyzer
 {
@@ -95,10 +136,93 @@ public:
 		TOTAL_RECALL      = 0x4
 	};
 
+	Analyzer();
+	~Analyzer();
+
+	// compiles the solution of the problem in advance, otherwise it's done by the first check
+	void prepare(const Problem& problem, const Options& options);
+
+	// with a reusable arena, like std::pmr::unsynchronized_pool_resource per session,
+	// checking of an answer doesn't allocate in the steady state
+	Verification check(const Problem& problem, const AnswerLines& answer, const Options& options,
+		std::pmr::memory_resource* arena = std::pmr::get_default_resource());
 	Verification check(
 		const Problem& problem, const std::list<std::string>& answer, const Options& options);
 
-	static std::list<Token> split_to_tokens(const std::string& s);
+	// checks the submissions on a pool of 'threads' workers (hardware concurrency if 0),
+	// results are in order of the submissions
+	std::vector<Verification> check(
+		const std::vector<Submission>& submissions, const Options& options, unsigned threads = 0);
+
+	static Tokens split_to_tokens(std::string_view s,
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	// tokens without spaces, downcased and without punctuation according to options;
+	// they are views into 's' or into 'folded', which keeps the downcased text
+	static Tokens tokens(std::string_view s, int options, std::pmr::string& folded);
+
+private:
+	friend class LiveCheck;
+	struct CompiledSolution;
+
+	using Verify = Verification (*)(const AnswerLines& answer, const CompiledSolution& solution,
+		double fuzzy_threshold, std::pmr::memory_resource* arena);
+
+	// <hash of the solution lines, OPTIONS>, the lines are compared on a hit, so a solution
+	// is found by its content and not by the address of the list, which may be reused
+	using SolutionKey = std::pair<size_t, int>;
+	std::multimap<SolutionKey, std::unique_ptr<const CompiledSolution>> solutions;
+
+	const CompiledSolution& compiled(const std::list<std::string>& solution, int options);
+
+	// specialized for every combination of OPTIONS, the one for a solution is chosen by compiling;
+	// doesn't touch the cache, so it may be called from several threads
+	template <int OPTIONS>
+	static Verification verify(const AnswerLines& answer, const CompiledSolution& solution,
+		double fuzzy_threshold, std::pmr::memory_resource* arena);
+
+	template <int OPTIONS>
+	static Tokens tokens(std::string_view s, std::pmr::string& folded);
+};
+
+
+/* checking of the answer as it is typed, mismatched tokens are reported as ERROR_TOKEN
+ *
+ * every line keeps its tokens with the automaton states after them, an edit re-analyzes
+ * the tokens after the changed symbol only; the last token of a line is not an error while
+ * it may be a beginning of a right one. Total recall mode is not checked as you type.
+ * Empty lines are skipped as by the verification, a line is checked against the solution
+ * line of its number among the not empty lines updated before it.
+ */
+class LiveCheck
+{
+public:
+	LiveCheck(Analyzer& analyzer, const Problem& problem, const Options& options);
+	~LiveCheck();
+
+	// errors are valid until the next update of the line
+	const std::vector<Error>& update(size_t line_num, std::string_view line);
+
+private:
+	struct LineToken
+	{
+		size_t pos, length; // in code points
+		bool right;
+		// the state after the token
+		size_t state;
+	};
+
+	struct Line
+	{
+		std::string text;
+		size_t solution_line = 0; // the tokens are checked against
+		std::vector<LineToken> tokens;
+		std::vector<Error> errors;
+		std::pmr::string folded;
+	};
+
+	const std::vector<Pattern>* patterns;
+	int options;
+	std::vector<Line> lines;
 };
 
 } // namespace analyze
@@ -0,0 +1,101 @@
+/*
+ * audio.h
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace audio {
+
+// mean amplitude of a voiced block, the silence of a microphone is below it
+const int16_t VOICE_THRESHOLD = 500;
+// audio before the first voiced block, so the start of the first word is not cut
+const int PRE_ROLL_MS = 300;
+
+// 16 bit mono samples
+class Source
+{
+public:
+	virtual ~Source() = default;
+
+	virtual int sample_rate() const = 0;
+	virtual void start() {}
+	virtual void stop() {}
+	// blocks until some samples are ready, returns 0 at the end of the source
+	virtual size_t read(int16_t* samples, size_t max) = 0;
+};
+
+// PCM 16 bit mono WAV file, for recognition without a microphone
+class WavSource : public Source
+{
+public:
+	// 'realtime' reads are paced as the samples of a microphone, for the latency measures
+	explicit WavSource(const std::string& path, bool realtime = false);
+
+	int sample_rate() const override { return rate; }
+	void start() override;
+	size_t read(int16_t* samples, size_t max) override;
+
+private:
+	std::ifstream file;
+	const bool realtime;
+	int rate = 0;
+	size_t left = 0; // samples in the data chunk
+	double started = 0;
+	size_t delivered = 0;
+};
+
+// writes PCM 16 bit mono WAV file
+void write_wav(const std::string& path, const std::vector<int16_t>& samples, int sample_rate);
+
+// last samples, the older ones are overwritten
+class RingBuffer
+{
+public:
+	explicit RingBuffer(size_t capacity);
+
+	void push(const int16_t* samples, size_t n);
+	size_t size() const { return count; }
+	// appends the samples in the order of arrival and clears the buffer
+	void drain(std::vector<int16_t>& out);
+	void clear() { count = 0; }
+
+private:
+	std::vector<int16_t> samples;
+	size_t head = 0; // next sample to write
+	size_t count = 0;
+};
+
+bool voiced(const int16_t* samples, size_t n, int16_t threshold = VOICE_THRESHOLD);
+
+// passes the audio since the first voiced block with the pre-roll before it
+class VoiceGate
+{
+public:
+	explicit VoiceGate(int sample_rate, int pre_roll_ms = PRE_ROLL_MS, int16_t threshold = VOICE_THRESHOLD);
+
+	// the samples to decode, empty until the voice
+	const std::vector<int16_t>& feed(const int16_t* samples, size_t n);
+	bool open() const { return opened; }
+	void reset();
+
+private:
+	const int16_t threshold;
+	RingBuffer pre_roll;
+	std::vector<int16_t> passed;
+	bool opened = false;
+};
+
+} // namespace audio
+
+#endif // AUDIO_H
@@ -10,27 +10,67 @@
 #ifndef EDITOR_H
 #define EDITOR_H
 
-#include <vector>
-#include <list>
 #include <string>
+#include <string_view>
+#include <vector>
+
+// display column after the symbol at 'column', as ncurses shows it: tabs to the stops,
+// the control characters as ^X, the wide ones by wcwidth
+size_t advance_column(size_t column, char32_t c, size_t tab_width);
+
+// utf8 octets of a line with a gap at the last edit: typing at one place
+// moves nothing, so an insertion is O(1) amortized
+class GapBuffer
+{
+	std::string buffer;
+	size_t gap_begin = 0, gap_end = 0;
+
+	void move_gap(size_t pos);
+
+public:
+	GapBuffer() = default;
+	explicit GapBuffer(std::string_view s);
+
+	size_t size() const { return buffer.size() - (gap_end - gap_begin); }
+	bool empty() const { return size() == 0; }
+	char operator[](size_t i) const { return buffer[i < gap_begin ? i : i + gap_end - gap_begin]; }
+
+	void insert(size_t pos, std::string_view s);
+	void erase(size_t pos, size_t length);
+	std::string substr(size_t pos, size_t length = std::string::npos) const;
+	std::string str() const { return substr(0); }
+
+	// the octets before and after the gap, they are drawn as they are
+	std::string_view before() const { return std::string_view(buffer.data(), gap_begin); }
+	std::string_view after() const { return std::string_view(buffer.data() + gap_end, buffer.size() - gap_end); }
+	// the line in one piece, the gap is moved to its end; valid until the next edit
+	std::string_view text();
+
+	// decodes the code point at octet 'pos' and moves 'pos' to the next one,
+	// an invalid octet is taken as is
+	char32_t code_point(size_t& pos) const;
+	// start of the code point before octet 'pos'
+	size_t previous(size_t pos) const;
+};
 
+// the positions in the lines are in octets, the cursor is always on a code point
 class Editor
 {
 	const size_t tab_width;
-	const size_t ascii_width;
-	const size_t utf8_width;
 
-	std::vector<std::string> lines;
-	// position of line's every symbol on screen, needs to handle tabs and utf-8 paired symbols
-	std::vector<std::vector<size_t>> screen_positions;
+	std::vector<GapBuffer> lines;
 
 	size_t cursor_x, cursor_y;
+	// display column of the cursor, follows the typing and is counted again after the jumps
+	size_t screen_x;
+	bool screen_x_valid;
 
-	bool is_ascii(char c);
-	size_t sym_width(char c);
+	size_t advance(size_t column, char32_t c) const;
+	size_t column(size_t y, size_t x) const;
+	// octet of the symbol at the display column, or of the end of the line
+	size_t position(size_t y, size_t column) const;
 
-	void put_cursor_inside_line();
-	void update_screen_positions(size_t x, size_t y);
+	void move_vertically(size_t y);
 
 public:
 	explicit Editor(size_t tab_size);
@@ -46,13 +86,18 @@ public:
 	void up();
 	void down();
 	void new_line();
-	void add_ch(char ch);
-	void add_ch(char ch_high, char ch_low);
-	void add_str(const std::string &s);
+	void add_ch(char32_t ch);
+	// the text may have several lines, returns true if the lines are added
+	bool add_str(const std::string &s);
+	// replaces 'length' bytes of the line from 'x', the cursor is moved with the text after them
+	void replace(size_t y, size_t x, size_t length, const std::string &s);
 
-	const std::vector<std::string>& get_lines();
-	std::list<std::string> get_lines_list();
-	const std::string& get_current_line();
+	size_t get_lines_count() const { return lines.size(); }
+	const GapBuffer& get_line(size_t y) const { return lines[y]; }
+	const GapBuffer& get_current_line() const { return lines[cursor_y]; }
+	// the line in one piece, for the views of the answer; moves the gap of the line
+	std::string_view get_text(size_t y) { return lines[y].text(); }
+	size_t get_cursor_x() const { return cursor_x; }
 	size_t get_screen_x();
 	size_t get_screen_y();
 };
@@ -0,0 +1,71 @@
+/*
+ * event_loop.h
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace tasks {
+
+/* loop of the UI thread: it waits for the input, the timers and the completions of
+ * the other threads at once, by poll on the input fd, an eventfd and timerfds;
+ * all the handlers run on the thread of the loop.
+ */
+class EventLoop
+{
+public:
+	enum class Wake {
+		READABLE, // the fd has the input
+		TIMEOUT,
+		EVENT,    // some handler has run or a signal has come
+	};
+
+	using Handler = std::function<void()>;
+
+	EventLoop();
+	~EventLoop();
+
+	EventLoop(const EventLoop&) = delete;
+	EventLoop& operator= (const EventLoop&) = delete;
+
+	// from any thread, the handler runs by the next wait
+	void post(Handler handler);
+
+	// the handler runs after 'first' and then every 'interval', 0 is once; returns the id
+	int add_timer(std::chrono::milliseconds first, std::chrono::milliseconds interval, Handler handler);
+	void remove_timer(int id);
+
+	// runs the handlers until 'fd' is readable, 'timeout_ms' passes (-1 is none)
+	// or some handler has run
+	Wake wait(int fd, int timeout_ms = -1);
+
+private:
+	struct Timer
+	{
+		Handler handler;
+		bool once;
+	};
+
+	int event_fd;
+	std::mutex mutex;
+	std::vector<Handler> posted;
+	std::map<int, Timer> timers; // by their fd
+
+	void run_posted();
+	void run_timer(int fd);
+};
+
+} // namespace tasks
+
+#endif // EVENT_LOOP_H
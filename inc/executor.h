@@ -0,0 +1,97 @@
+/*
+ * executor.h
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tasks {
+
+enum class Priority {
+	HIGH,   // the user waits for it, e.g. speech
+	NORMAL, // e.g. saves
+	LOW,    // e.g. prefetching
+};
+
+// cancellation token, one per task: a cancelled task is dropped before its start,
+// a running one checks the token by itself
+class Token
+{
+public:
+	Token();
+
+	void cancel();
+	bool cancelled() const;
+
+	// the task is finished or dropped
+	bool done() const;
+	// blocks until the task is finished or dropped
+	void wait() const;
+
+private:
+	friend class Executor;
+
+	struct State;
+	std::shared_ptr<State> state;
+
+	void finish();
+};
+
+// fixed number of workers, the tasks of a higher priority are taken first
+class Executor
+{
+public:
+	using Task = std::function<void(const Token& token)>;
+
+	explicit Executor(unsigned threads);
+	// the queued tasks are finished, if they are not cancelled
+	~Executor();
+
+	Executor(const Executor&) = delete;
+	Executor& operator= (const Executor&) = delete;
+
+	Token submit(Priority priority, Task task, Token token = Token());
+	// blocks until all the submitted tasks are finished or dropped
+	void wait();
+
+	unsigned threads() const { return static_cast<unsigned>(workers.size()); }
+
+	// background work of the quiz: speech, prefetching and saves
+	static Executor& shared();
+
+private:
+	struct Entry
+	{
+		Task task;
+		Token token;
+	};
+
+	std::mutex mutex;
+	std::condition_variable queued, idle;
+	std::deque<Entry> queues[3]; // by priority
+	size_t running = 0;
+	bool stopping = false;
+
+	std::vector<std::thread> workers;
+
+	bool empty() const;
+	void run();
+};
+
+} // namespace tasks
+
+#endif // EXECUTOR_H
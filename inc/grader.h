@@ -0,0 +1,44 @@
+/*
+ * grader.h
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#ifndef GRADER_H
+#define GRADER_H
+
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include <analyzer.h>
+#include <options.h>
+#include <problem.h>
+
+namespace grading {
+
+/* offline grading of written answers, a JSON object per line
+ *
+ * input, the problem is set by its number in the quiz or by the question:
+ *   {"problem": 3, "answer": ["ja, genau"]}
+ *   {"question": ["yes, exactly"], "answer": ["ja genau"]}
+ *
+ * output, in order of input lines:
+ *   {"line": 2, "problem": 3, "state": 8, "right": false,
+ *    "errors": [{"line": 0, "what": "missed", "str": " ", "pos": 1}]}
+ *   {"line": 5, "error": "unknown problem"}
+ *
+ * total recall mode reports the wrong and missed phrases in "solution"
+ */
+
+// returns the number of input lines, which were not graded
+size_t grade(const std::vector<std::shared_ptr<Problem>>& problems,
+	const Options& options, std::istream& in, std::ostream& out);
+
+} // namespace grading
+
+#endif // GRADER_H
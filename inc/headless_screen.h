@@ -0,0 +1,108 @@
+/*
+ * headless_screen.h
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#ifndef HEADLESS_SCREEN_H
+#define HEADLESS_SCREEN_H
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <viewer.h>
+
+namespace view {
+
+namespace headless {
+
+// a key of the input script
+struct Input
+{
+	enum class Key { CHARACTER, BACKSPACE, F2, F3, F12 };
+
+	Key key;
+	char32_t code = 0; // of CHARACTER, '\n' is the enter
+};
+
+/* the screen without a terminal, for the tests and the benchmarks: the keys come
+ * from a script, every change is drawn to a grid of cells in the layout of the
+ * terminal screen, and the time from a key to its frame is measured.
+ *
+ * the end of the script is F12, so a session always finishes.
+ */
+class HeadlessScreen : public Screen
+{
+public:
+	HeadlessScreen(bool enter_accept_mode, int height = 40, int width = 120);
+
+	// characters of the text, '\n' as the enter
+	void type(std::string_view text);
+	void press(Input::Key key);
+	bool script_done() const { return script.empty(); }
+
+	// code points of the row, the empty cells are spaces
+	const std::u32string& cells(int y) const { return grid[y]; }
+	// the row in utf8 without the trailing spaces
+	std::string row(int y) const;
+	bool shows(std::string_view text) const;
+
+	size_t frames() const { return frame_count; }
+	// from a key of the answer to the frame with it, in seconds
+	const std::vector<double>& key_latencies() const { return latencies; }
+
+	virtual INPUT_STATE get_answer(analysis::AnswerLines& answer) override;
+	virtual int wait_pressed_key() override;
+
+	virtual void set_language(utils::Language language) override;
+	virtual void update_statistic(const Statistics& statistics) override;
+	virtual void show_problem(const Problem& problem) override;
+	virtual void set_live_check(const LiveCheck& check) override;
+	virtual void show_result(const std::shared_ptr<const analysis::Verification>& verification) override;
+	virtual void show_solution() override;
+	virtual void show_message(const std::string& message) override;
+	// the script has no real time, the limit is kept only
+	virtual void set_time_limit(int seconds) override { time_limit = seconds; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	enum class Mode { WAIT, INPUT, OUTPUT };
+
+	const bool enter_accept_mode;
+	const int height, width;
+
+	std::deque<Input> script;
+	std::vector<std::u32string> grid;
+	size_t frame_count = 0;
+	std::vector<double> latencies;
+
+	// the model, drawn whole for every frame
+	Statistics statistics = {};
+	SharedLines question, solution;
+	bool solution_visible = false;
+	Mode mode = Mode::WAIT;
+	std::vector<std::string> lines = { std::string() }; // of the answer being typed
+	std::shared_ptr<const analysis::Verification> verification;
+	LiveCheck live_check;
+	std::string message;
+	utils::Language language = utils::Language::UNKNOWN;
+	int time_limit = 0;
+
+	Input next();
+	void edit(const Input& input);
+	void draw();
+	void draw_text(int y, int x, std::string_view text);
+};
+
+} // namespace headless
+
+} // namespace view
+
+#endif // HEADLESS_SCREEN_H
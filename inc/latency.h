@@ -0,0 +1,80 @@
+/*
+ * latency.h
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace latency {
+
+using Clock = std::chrono::steady_clock;
+
+// from a key to its frame on the terminal
+enum class Event {
+	KEY,        // an edit of the answer
+	SUBMIT,     // the answer to its checked result
+	TRANSITION, // the key after the result to the next problem
+	COUNT
+};
+
+const char* event_name(Event event);
+
+/* counts of the nanoseconds in log-linear buckets: 8 of them for every power of 2,
+ * so a value is kept within 12.5% at a fixed size and a record is O(1)
+ */
+class Histogram
+{
+public:
+	static const int SUB_BUCKETS = 8;
+	static const int BUCKETS = 62 * SUB_BUCKETS; // the values below 8 and the powers 3..63
+
+	void record(std::chrono::nanoseconds value);
+
+	uint64_t count() const { return total; }
+	std::chrono::nanoseconds max() const { return std::chrono::nanoseconds(maximum); }
+	std::chrono::nanoseconds mean() const;
+	// the lower bound of the bucket with the 'p' share of the values, 0 <= p <= 1
+	std::chrono::nanoseconds percentile(double p) const;
+
+	// a summary line and the not empty buckets
+	void write(std::ostream& os, const std::string& name) const;
+
+	static int bucket(uint64_t ns);
+	static uint64_t lower_bound(int bucket);
+
+private:
+	std::array<uint64_t, BUCKETS> counts = {};
+	uint64_t total = 0, sum = 0, maximum = 0;
+};
+
+namespace detail {
+extern bool on;
+} // namespace detail
+
+/* the instrumentation of the input path, it's off unless QUIZ_LATENCY names a file;
+ * the histograms are appended to it on exit and on SIGUSR1.
+ * off it costs a test of a flag, the clock is not read
+ */
+void enable(const std::string& filename);
+inline bool enabled() { return detail::on; }
+void record(Event event, Clock::time_point start);
+const Histogram& histogram(Event event);
+
+// true once after a SIGUSR1
+bool dump_requested();
+void dump();
+
+} // namespace latency
+
+#endif // LATENCY_H
@@ -12,10 +12,15 @@
 
 #include <tuple>
 #include <map>
+#include <chrono>
+#include <cstdio>
 #include <memory>
 
 #include <ncursesw/ncurses.h>
 
+#include <event_loop.h>
+#include <latency.h>
+#include <render.h>
 #include <viewer.h>
 #include <window.h>
 
@@ -26,22 +31,31 @@ namespace ncurses {
 class NScreen : public Screen
 {
 public:
-	explicit NScreen(bool enter_accept_mode, int tab_size);
+	// the terminal is written to 'output', e.g. a pipe for the measures
+	NScreen(bool enter_accept_mode, int tab_size, FILE* output = stdout);
 	virtual ~NScreen();
 
-	virtual std::tuple<Screen::INPUT_STATE, std::list<std::string>> get_answer();
+	virtual Screen::INPUT_STATE get_answer(analysis::AnswerLines& answer);
 	virtual int wait_pressed_key();
 
 	virtual void set_language(utils::Language layout);
 	virtual void update_statistic(const Statistics &s);
 	virtual void show_problem(const Problem& problem);
-	virtual void show_result(const analysis::Verification& v);
+	virtual void set_live_check(const LiveCheck& check);
+	virtual void show_result(const std::shared_ptr<const analysis::Verification>& v);
 	virtual void show_solution();
 	virtual void show_message(const std::string& s);
+	virtual void set_time_limit(int seconds);
 
 private:
 	bool enter_accept_mode;
 
+	SCREEN* terminal;
+	FILE* output;
+
+	// the windows wait for the keys in it, so it's made before them
+	tasks::EventLoop loop;
+
 	std::unique_ptr<StatisticWindow> window_statistic;
 	std::unique_ptr<QuestionWindow>  window_question;
 	std::unique_ptr<SolutionWindow>  window_solution;
@@ -49,9 +63,24 @@ private:
 	std::unique_ptr<AnswerWindow>    window_answer;
 
 	void resize();
+	void present();
+
+	// the clock of the problem ticks every second from its show to its result
+	void start_clock();
+	void stop_clock();
+	void tick();
+
+	// the event of the last key is measured until its frame, when the latencies are on
+	void track(latency::Event event);
+	void done(latency::Event event);
+
+	latency::Event tracked = latency::Event::COUNT;
+	latency::Clock::time_point key_read;
 
-	Statistics current_statistic;
-	Problem current_problem;
+	int time_limit = 0;
+	int clock_timer = -1;
+	bool time_over = false;
+	std::chrono::steady_clock::time_point problem_shown;
 };
 
 } // namespace ncurses
@@ -12,23 +12,29 @@
 
 #include <analyzer.h>
 
+#include <cstdint>
 #include <string>
 
 namespace cmd {
 
 static const std::string HELP_MESSAGE =
+	"-a    check the answer as you type\n" \
 	"-c    case unsensitive\n" \
 	"-e    accept answer by enter key\n" \
+	"-f    fuzzy, accept words with typos: max share of wrong symbols (default 0.2)\n" \
+	"-g    grade written answers: JSON lines file (stdin if not set), results to stdout\n" \
 	"-h    show this help\n" \
 	"-i    invert questions and solutions, discard mixed mode (-m)\n" \
 	"-l    input language auto-detect\n" \
 	"-m    mixed mode, question and solution may be swapped\n" \
+	"-o    time limit of a problem: seconds, the answer is checked when it's over\n" \
 	"-p    play the solution\n" \
 	"-q    not show question\n" \
 	"-r    include to quiz problems, which were with errors last time only\n" \
 	"-s    show statistic\n" \
 	"-t    use topics\n" \
-	"-u    punctuation unsensitive\n"
+	"-u    punctuation unsensitive\n" \
+	"-v    prerender the audio of the quiz (of its topics with -t) to the cache: number of workers (default all cores)\n" \
 	"-w    play the question\n" \
 	"-z    total recall\n";
 
@@ -53,21 +59,36 @@ public:
 		ANALYSIS_CASE_UNSENSITIVE,
 		ANALYSIS_PUNTCTUATION_UNSENSITIVE,
 		ANALYSIS_TOTAL_RECALL,
+		ANALYSIS_FUZZY,
+		GRADE,
+		LIVE_CHECK,
+		PRERENDER,
+		TIME_LIMIT,
 	};
 
 	bool parse_arguments(int argc, char* argv[]);
-	bool get(Flags flag) const;
+	// the flags are frozen into a bitmask by parse_arguments, so it's a bit test
+	bool get(Flags flag) const { return (_flags & (1u << flag)) != 0; }
 	std::list<std::string> args(Flags flag) const;
 
 	bool help() const { return _show_help; }
+	double fuzzy_threshold() const { return _fuzzy_threshold; }
+	// 0 is all the cores
+	unsigned prerender_threads() const { return _prerender_threads; }
+	// seconds, 0 is no limit
+	int time_limit() const { return _time_limit; }
 	const std::string& filename() const { return _filename; }
 
 private:
 	static std::map<char, Flags > args_lookup_table;
 
 	std::map<Flags, std::list<std::string> > _args;
+	uint32_t _flags = 0;
+	double _fuzzy_threshold = 0.2;
+	unsigned _prerender_threads = 0;
+	int _time_limit = 0;
 	std::string _filename;
-	bool _show_help;
+	bool _show_help = false;
 };
 
 #endif // OPTIONS_H
@@ -0,0 +1,82 @@
+/*
+ * pattern.h
+ *
+ *  Created on: Oct 18, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <analyzer.h>
+
+namespace analysis {
+
+/* solution line with alternatives, compiled to a DFA over tokens
+ *
+ * < {colour|color} of the sky  -> one of the alternatives
+ * < give {the|} book           -> optional part
+ * < {big|large|huge} house     -> synonym set
+ *
+ * alternatives match whole tokens, braces without '|' are literal text
+ */
+class Pattern
+{
+public:
+	// options - Analyzer::OPTIONS, applied to tokens of the alternatives
+	Pattern(const std::string& line, int options);
+
+	Pattern(Pattern&& p) = default;
+	Pattern& operator= (Pattern&& p) = default;
+
+	// answer tokens have to be prepared by Analyzer::tokens with the same options
+	bool match(const Tokens& answer) const;
+
+	// tokens of the alternative closest to the answer, for errors reporting;
+	// views into the pattern and the answer, in memory of the answer tokens
+	Tokens closest(const Tokens& answer) const;
+
+	// stepwise matching for checking as you type, starts from the state START;
+	// a wrong token is replaced by the closest edge, 'right' is false then
+	static constexpr size_t START = 0;
+	size_t advance(size_t state, std::string_view token, bool& right) const;
+	// some token from the state begins with 'prefix', it may be not typed completely
+	bool continues(size_t state, std::string_view prefix) const;
+
+	// every group is replaced by its first alternative
+	static std::string plain(const std::string& line);
+
+private:
+	static constexpr size_t NONE = static_cast<size_t>(-1);
+
+	struct State
+	{
+		// <token, next state> in order of alternatives
+		std::vector<std::pair<std::string, size_t>> edges;
+		// views into 'edges'
+		std::unordered_map<std::string_view, size_t> next;
+
+		bool accepting = false;
+		// edge on the shortest way to an accepting state
+		size_t witness = NONE;
+	};
+
+	std::vector<State> states;
+
+	size_t step(size_t state, std::string_view token) const;
+	// edge with most of symbols on their places
+	size_t closest_edge(size_t state, std::string_view token) const;
+};
+
+} // namespace analysis
+
+#endif // PATTERN_H
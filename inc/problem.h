@@ -11,7 +11,10 @@
 #define PROBLEM_H
 
 #include <string>
+#include <string_view>
 #include <list>
+#include <memory>
+#include <vector>
 #include <utils.h>
 
 /* problem example:
@@ -30,6 +33,30 @@
  */
 
 
+// lines of a question or a solution, they don't change after the parsing,
+// so the copies of the problem and the views share them;
+// the views take the visible lines by their numbers from the index
+struct Lines
+{
+	std::list<std::string> list;
+	std::vector<std::string_view> index; // of the list
+
+	explicit Lines(std::list<std::string> l = {})
+		: list(std::move(l))
+		, index(list.begin(), list.end())
+	{}
+
+	Lines(const Lines&) = delete;
+	Lines& operator= (const Lines&) = delete;
+
+	size_t size() const { return index.size(); }
+	std::string_view operator[](size_t i) const { return index[i]; }
+	auto begin() const { return index.begin(); }
+	auto end() const { return index.end(); }
+};
+
+using SharedLines = std::shared_ptr<const Lines>;
+
 class Problem {
 public:
 	size_t question_hash = 0;
@@ -43,13 +70,14 @@ public:
 	bool inverted = false;
 	bool not_show_question = false;
 
+	// the lines are moved in, if they are not needed after
 	Problem(
-		const std::list<std::string> &q,
-		const std::list<std::string> &s,
+		std::list<std::string> q,
+		std::list<std::string> s,
 		utils::Language lang_question,
 		utils::Language lang_solution)
-		: _question(q)
-		, _solution(s)
+		: _question(std::make_shared<const Lines>(std::move(q)))
+		, _solution(std::make_shared<const Lines>(std::move(s)))
 		, _lang_question(lang_question)
 		, _lang_solution(lang_solution)
 	{}
@@ -64,6 +92,9 @@ public:
 
 	const std::list<std::string>& question() const;
 	const std::list<std::string>& solution() const;
+	// the same lines, to be kept without a copy
+	SharedLines shared_question() const;
+	SharedLines shared_solution() const;
 
 	std::string question_str() const;
 	std::string solution_str() const;
@@ -72,8 +103,8 @@ public:
 	utils::Language solution_lang() const;
 
 private:
-	std::list<std::string> _question;
-	std::list<std::string> _solution;
+	SharedLines _question = std::make_shared<const Lines>();
+	SharedLines _solution = std::make_shared<const Lines>();
 
 	utils::Language _lang_question;
 	utils::Language _lang_solution;
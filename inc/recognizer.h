@@ -0,0 +1,77 @@
+/*
+ * recognizer.h
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#ifndef RECOGNIZER_H
+#define RECOGNIZER_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <audio.h>
+
+struct cmd_ln_s;
+struct ps_decoder_s;
+struct ad_rec_s;
+
+namespace audio {
+
+// the default microphone
+class Microphone : public Source
+{
+public:
+	explicit Microphone(int sample_rate);
+	~Microphone();
+
+	Microphone(const Microphone&) = delete;
+	Microphone& operator= (const Microphone&) = delete;
+
+	int sample_rate() const override { return rate; }
+	void start() override;
+	void stop() override;
+	// throws, if the device gives no samples for a second
+	size_t read(int16_t* samples, size_t max) override;
+
+private:
+	ad_rec_s* ad;
+	const int rate;
+};
+
+// pocketsphinx decoder, the models are loaded once, it takes seconds
+class Recognizer
+{
+public:
+	// 'final' is false for the partial hypotheses
+	using Hypothesis = std::function<void(const std::string& text, bool final)>;
+	// checked by every block, e.g. for a cancel or a timeout
+	using Stop = std::function<bool()>;
+
+	Recognizer();
+	~Recognizer();
+
+	Recognizer(const Recognizer&) = delete;
+	Recognizer& operator= (const Recognizer&) = delete;
+
+	int sample_rate() const;
+
+	// decodes an utterance: from the first voiced block until the end of the speech,
+	// of the source or the stop, the partial hypotheses are passed as they change
+	std::string recognize(Source& source, const Hypothesis& hypothesis = Hypothesis(), const Stop& stop = Stop());
+
+private:
+	cmd_ln_s* config;
+	ps_decoder_s* ps;
+
+	std::mutex mutex; // an utterance at a time
+};
+
+} // namespace audio
+
+#endif // RECOGNIZER_H
@@ -0,0 +1,105 @@
+/*
+ * render.h
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <ncursesw/ncurses.h>
+
+namespace view {
+
+namespace ncurses {
+
+/* content of a window: the last committed frame is kept, so a commit redraws
+ * the changed lines only, and ncurses sends the changed cells of them.
+ *
+ * the text is added as by waddstr: from the position of the last move,
+ * or after the previous text of the line.
+ */
+class Frame
+{
+public:
+	// starts a new frame of the window size, the next commit redraws all the lines
+	void reset(int height, int width);
+	// starts a new frame, the lines are compared with the committed ones
+	void clear();
+	void clear_line(int y);
+
+	void move(int y, int x);
+	void add(std::string_view text, int color = 0, bool bold = false);
+	void add_line(int y, int x, std::string_view text, int color = 0, bool bold = false) {
+		move(y, x);
+		add(text, color, bold);
+	}
+
+	// draws the changed lines, returns their number
+	size_t commit(WINDOW* window);
+
+	int height() const { return static_cast<int>(next.size()); }
+	int width() const { return columns; }
+
+private:
+	struct Span
+	{
+		int x; // -1 after the previous span
+		std::string text;
+		int color;
+		bool bold;
+
+		bool operator== (const Span& s) const {
+			return x == s.x && color == s.color && bold == s.bold && text == s.text;
+		}
+	};
+
+	using Line = std::vector<Span>;
+
+	std::vector<Line> next, last;
+	std::vector<bool> drawn; // the line of the window is the last one
+	std::vector<int> reached; // last line of the window written by the line
+	int columns = 0;
+	int cursor_y = 0, cursor_x = 0;
+	bool moved = false;
+};
+
+// visible slice of a content longer than the window: the lines [begin, end),
+// only they are drawn, whatever the size of the content
+class Viewport
+{
+public:
+	void set_rows(size_t rows);
+	// the offset is kept inside the content
+	void set_lines(size_t lines);
+
+	void top() { offset = 0; }
+	void scroll_by(long lines);
+	// one line of the previous page is left on the next one
+	void page(int direction) { scroll_by(direction * static_cast<long>(rows > 1 ? rows - 1 : 1)); }
+	// scrolls to the line, e.g. of the cursor
+	void show(size_t line);
+
+	size_t begin() const { return offset; }
+	size_t end() const { return std::min(lines, offset + rows); }
+	bool visible(size_t line) const { return line >= begin() && line < end(); }
+	size_t size() const { return lines; }
+	bool clipped() const { return lines > rows; }
+
+private:
+	size_t rows = 0, lines = 0, offset = 0;
+};
+
+} // namespace ncurses
+
+} // namespace view
+
+#endif // RENDER_H
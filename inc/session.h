@@ -0,0 +1,73 @@
+/*
+ * session.h
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <executor.h>
+#include <options.h>
+#include <problem.h>
+#include <utils.h>
+#include <viewer.h>
+
+namespace session {
+
+// statistic is saved in the background after every answer, so the progress survives a crash
+class StatisticSaver
+{
+public:
+	explicit StatisticSaver(const std::string& filename) : filename(filename) {}
+	~StatisticSaver() { if (last) last->wait(); }
+
+	// a snapshot of the problems, a newer one supersedes the waiting one
+	void save_in_background(const std::vector<std::shared_ptr<Problem>>& problems);
+	void save(const std::vector<std::shared_ptr<Problem>>& problems);
+
+private:
+	const std::string filename;
+	std::mutex mutex; // the saves don't write the file at once
+	std::optional<tasks::Token> last;
+};
+
+// phrases of the problem to play, the same for the quiz and the prerendering
+std::string question_phrase(const std::list<std::string>& question);
+// alternatives of the solution are played by the first one
+std::string solution_phrase(const std::list<std::string>& solution);
+
+// speaks the phrase in the language
+using Player = std::function<void(const std::string&, utils::Language)>;
+// prepares the phrases to be played at once, e.g. renders them to the audio cache
+struct Warmer
+{
+	// runs on a worker and stops by the cancel of the token, when the problem is not the next one anymore
+	std::function<void(const std::vector<std::pair<std::string, utils::Language>>&, const tasks::Token&)> warm;
+	// stops at once the warm of a cancelled token, called from the thread of the session
+	std::function<void()> interrupt;
+};
+
+// asks the problems on the screen in random order, 'seed' of the order, until all of them
+// are solved or the exit; the same loop for a terminal and the headless screen.
+// the next problem is chosen and prepared on a worker while the current one is answered,
+// its phrases to play are warmed by 'warmer'; the warms are finished by the return
+void run(std::vector<std::shared_ptr<Problem>>& problems, const Options& options, view::Screen& screen,
+	StatisticSaver& saver, const Player& play, uint32_t seed, const Warmer& warmer = Warmer());
+
+} // namespace session
+
+#endif // SESSION_H
@@ -0,0 +1,180 @@
+/*
+ * speech.h
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#ifndef SPEECH_H
+#define SPEECH_H
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <executor.h>
+#include <utils.h>
+
+namespace speech {
+
+struct Phrase
+{
+	std::string text;
+	utils::Language language;
+};
+
+/* speech process, a request is a line on its stdin, the answer is a line on its stdout
+ *
+ *   say\t<language code>\t<text>               - speak
+ *   play\t<language code>\t<text>\t<file>      - play the audio file, render it before if it's absent
+ *   render\t<language code>\t<text>\t<file>    - render the audio file only
+ *   stop                                       - stop the phrase being spoken
+ *
+ * the answer is "ok" or an error message, every request is answered in order;
+ * a stopped phrase is answered at once, by "stopped".
+ */
+class Process
+{
+public:
+	// 'command' is executed without a shell, the first word is looked up in PATH
+	explicit Process(const std::vector<std::string>& command);
+	// the process exits by the end of its input
+	~Process();
+
+	Process(const Process&) = delete;
+	Process& operator= (const Process&) = delete;
+
+	// starts the process in advance, otherwise it's started by the first request
+	bool start();
+	// the process is restarted once, if it has exited, but not after the interruption;
+	// returns an empty string, if it has failed
+	std::string request(const std::string& line, const tasks::Token& token = tasks::Token());
+	// interrupts the current request from another thread, its token has to be cancelled before:
+	// the process is sent a stop request, it's killed if it isn't answered in a moment
+	void interrupt();
+
+	const std::vector<std::string>& command() const { return _command; }
+
+private:
+	const std::vector<std::string> _command;
+
+	std::mutex mutex; // for pid only, the rest is used by the requesting thread
+	pid_t pid = -1;
+	int to_process = -1, from_process = -1;
+	int wake = -1; // eventfd, wakes the requesting thread by an interruption
+	std::string received; // not a whole line yet
+
+	void stop();
+	void kill();
+	bool exchange(const std::string& line, std::string& answer);
+	bool receive(std::string& answer);
+};
+
+
+// audio files of the phrases, the least recently used ones are removed above the capacity
+class AudioCache
+{
+public:
+	AudioCache(const std::filesystem::path& dir, uintmax_t capacity);
+
+	// content-addressed: by the text, the language and the speech engine
+	std::filesystem::path file(std::string_view text, utils::Language language, std::string_view engine) const;
+	// marks the file as used now, returns false if it's not in the cache
+	bool use(const std::filesystem::path& file);
+	// accounts a new file of the cache, returns false if the file is absent
+	bool add(const std::filesystem::path& file);
+
+private:
+	const std::filesystem::path dir;
+	const uintmax_t capacity;
+
+	std::mutex mutex;
+	uintmax_t size = 0;
+
+	void trim();
+};
+
+// request line of the phrase for the process: "say", or "play" and "render" with the file
+std::string request_line(std::string_view verb, const Phrase& phrase, const std::filesystem::path& file = {});
+
+
+/* phrases are spoken by the tasks of the executor, one by one
+ *
+ * the process is started in advance, so the phrases don't wait for its start;
+ * with a cache the phrases are played from the audio files, rendered by the first play.
+ */
+class Speaker
+{
+public:
+	Speaker(const std::vector<std::string>& command, tasks::Executor& executor,
+		AudioCache* cache = nullptr, const std::string& engine = std::string());
+	// the phrase being spoken is interrupted
+	~Speaker();
+
+	Speaker(const Speaker&) = delete;
+	Speaker& operator= (const Speaker&) = delete;
+
+	// doesn't block, the phrase supersedes the one being spoken and the waiting one
+	void say(const std::string& text, utils::Language language);
+	// blocks until the last phrase is spoken
+	void wait();
+
+private:
+	Process process;
+	tasks::Executor& executor;
+	AudioCache* const cache;
+	const std::string engine;
+
+	std::mutex mutex; // of the tokens
+	std::vector<tasks::Token> tokens; // of the not finished tasks, the last one is current
+	std::atomic<bool> speaking { false };
+
+	std::mutex process_mutex; // the phrases are spoken one by one
+
+	void submit(std::function<void(const tasks::Token&)> task);
+	void speak(const Phrase& phrase, const tasks::Token& token);
+};
+
+// renders the phrases to the cache one by one on its process, which is kept for the next ones;
+// may be used from several threads, the requests wait for each other
+class Renderer
+{
+public:
+	Renderer(const std::vector<std::string>& command, AudioCache& cache, const std::string& engine);
+
+	Renderer(const Renderer&) = delete;
+	Renderer& operator= (const Renderer&) = delete;
+
+	// renders the phrase, if it's missing in the cache; returns false, if it has failed or
+	// it's cancelled, 'error' is the answer of the process then
+	bool render(const Phrase& phrase, const tasks::Token& token, std::string& error);
+	// stops the phrase being rendered from another thread, if its token is cancelled
+	void interrupt();
+
+private:
+	Process process;
+	AudioCache& cache;
+	const std::string engine;
+
+	std::mutex mutex; // of the process
+	std::mutex rendering_mutex;
+	std::optional<tasks::Token> rendering; // of the phrase being rendered
+};
+
+// renders the phrases missing in the cache on 'threads' speech processes (hardware
+// concurrency if 0), returns the number of rendered phrases
+size_t prerender(const std::vector<std::string>& command, const std::string& engine,
+	AudioCache& cache, const std::vector<Phrase>& phrases, unsigned threads = 0);
+
+} // namespace speech
+
+#endif // SPEECH_H
@@ -10,7 +10,10 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <list>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace utils {
@@ -19,18 +22,54 @@ enum class Language {
 	UNKNOWN,
 	EN,
 	RU,
-	NL
+	NL,
+	DE,
+	FR,
+	ES,
+	UK
 };
 
 void trim_spaces(std::string& s);
 void remove_duplicate_spaces(std::string& s);
-void to_lower(std::u16string& s);
 std::vector<std::string> split(const std::string& s, const std::string& delimeter);
+// of the lines, not of their concatenation: { "ab", "c" } and { "a", "bc" } differ
+size_t hash_lines(const std::list<std::string>& lines);
 
-// only Basic Multilingual Plane
-std::u16string to_utf16(const std::string& s);
+// all of Unicode, invalid utf8 sequences throw std::runtime_error
+bool is_valid_utf8(std::string_view s);
+// length in code points
+size_t utf8_length(std::string_view s);
+// byte offset of the code point with index 'n'
+size_t utf8_offset(std::string_view s, size_t n);
+// decodes the code point at byte 'pos' and moves 'pos' to the next one
+char32_t next_code_point(std::string_view s, size_t& pos);
+void append_utf8(std::string& s, char32_t c);
+// writes up to 4 octets, returns the end of the written ones
+char* encode_utf8(char* out, char32_t c);
+
+std::u16string to_utf16(std::string_view s);
+std::u32string to_utf32(std::string_view s);
 std::string to_utf8(const std::u16string& s);
-Language what_language(const std::u16string& s);
+std::string to_utf8(const std::u32string& s);
+
+// case folding and NFC composition by compile-time tables for Latin, Greek and Cyrillic,
+// independent from the locale
+char32_t fold_case(char32_t c);
+void fold_case(std::string& s);
+void fold_case(std::pmr::string& s);
+void normalize(std::string& s);
+void normalize(std::pmr::string& s);
+
+// Levenshtein distance in code points, bit-parallel for words up to 64 symbols;
+// returns max_distance + 1 as soon as the distance is known to exceed max_distance
+size_t edit_distance(const std::u32string& a, const std::u32string& b, size_t max_distance);
+
+// ISO 639-1 code, as in the language line of a quiz: "en", "ru", ...; empty for UNKNOWN
+const char* language_code(Language language);
+Language language_by_code(std::string_view code);
+// by the script, the letters specific to a language and a byte trigram model of frequent words;
+// doesn't allocate, UNKNOWN for text without letters and invalid utf8
+Language what_language(std::string_view s);
 
 } // namespace utils
 
@@ -10,10 +10,13 @@
 #ifndef VIEWER_H
 #define VIEWER_H
 
+#include <functional>
 #include <list>
 #include <map>
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include <analyzer.h>
 #include <problem.h>
@@ -36,17 +39,27 @@ public:
 		EXIT
 	};
 
+	// errors of the answer line <line number, line>, called on every edit of the line
+	using LiveCheck = std::function<const std::vector<analysis::Error>&(size_t, std::string_view)>;
+
 	virtual ~Screen() { }
 
-	virtual std::tuple<INPUT_STATE, std::list<std::string>> get_answer() = 0;
+	// 'answer' is filled by views into the input buffer, valid until the next problem is shown
+	virtual INPUT_STATE get_answer(analysis::AnswerLines& answer) = 0;
 	virtual int wait_pressed_key() = 0;
 
 	virtual void set_language(utils::Language layout) = 0;
 	virtual void update_statistic(const Statistics& statistics) = 0;
+	// the lines of the problem are shared by the screen, not copied
 	virtual void show_problem(const Problem&) = 0;
-	virtual void show_result(const analysis::Verification&) = 0;
+	// until the next problem, an empty one disables it
+	virtual void set_live_check(const LiveCheck& check) = 0;
+	// the result is kept by the screen until the next problem
+	virtual void show_result(const std::shared_ptr<const analysis::Verification>& verification) = 0;
 	virtual void show_solution() = 0;
 	virtual void show_message(const std::string& s) = 0;
+	// seconds of every next problem, its answer is entered when they are over; 0 is no limit
+	virtual void set_time_limit(int seconds) = 0;
 };
 
 } // namespace view
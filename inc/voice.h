@@ -10,13 +10,86 @@
 #ifndef RECORD_H
 #define RECORD_H
 
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include <executor.h>
 #include <utils.h>
 
+namespace speech {
+class Renderer;
+}
+
 class AudioRecord {
 public:
-	static std::string capture();
+	// hypotheses of a capture, written by the recognition and read by the UI
+	class Transcript
+	{
+	public:
+		void update(const std::string& text, bool final);
+		// the capture has failed, it's final
+		void fail(const std::string& error);
+		// returns false, if the hypothesis has not changed since the last call;
+		// 'error' is not empty, if the capture has failed
+		bool take(std::string& text, bool& final, std::string& error);
+		// called on the thread of the capture after every update, e.g. to wake the UI
+		void set_listener(const std::function<void()>& listener);
+		// the capture is stopped by its next block of the audio, the listener is not called anymore
+		void cancel();
+
+	private:
+		friend class AudioRecord;
+
+		std::mutex mutex;
+		std::function<void()> listener;
+		std::string hypothesis;
+		std::string failure;
+		bool finished = false;
+		bool changed = false;
+		tasks::Token token; // of the capture
+	};
+
+	// loads the speech recognition in the background, once for all the captures
+	static void prepare_capture();
+	// blocks until a phrase is recognized, an empty one without the audio support, at most
+	// CAPTURE_TIMEOUT or until the cancel of 'token'; the partial hypotheses and the errors are
+	// passed to the transcript, without it the errors are thrown
+	static std::string capture(Transcript* transcript = nullptr, const tasks::Token& token = tasks::Token());
+	// returns at once, the phrase is recognized by a background task
+	static std::shared_ptr<Transcript> capture_async(const std::function<void()>& listener = nullptr);
+	// starts the speech process in advance, otherwise it's started by the first phrase
+	static void prepare();
+	// returns at once, the phrase is spoken by the speech process and supersedes the previous one
 	static void play(const std::string& phrase, utils::Language lang = utils::Language::UNKNOWN);
+	// renders the phrases missing in the audio cache on 'threads' workers (all the cores if 0),
+	// returns the number of rendered phrases
+	static size_t prerender(const std::vector<std::pair<std::string, utils::Language>>& phrases, unsigned threads = 0);
+
+	// renders the phrases of the next problems on a speech process kept for them, so their play
+	// starts at once; nothing is written to the terminal, a phrase not rendered is rendered by
+	// its play. the owner outlives the warm calls, e.g. the quiz session waits for them
+	class Warmer
+	{
+	public:
+		Warmer();
+		~Warmer();
+
+		Warmer(const Warmer&) = delete;
+		Warmer& operator= (const Warmer&) = delete;
+
+		// blocks, stops by the cancel of 'token' between the phrases
+		void warm(const std::vector<std::pair<std::string, utils::Language>>& phrases,
+			const tasks::Token& token = tasks::Token());
+		// stops the phrase being rendered at once, if the token of its warm is cancelled
+		void interrupt();
+
+	private:
+		std::unique_ptr<speech::Renderer> renderer;
+	};
 };
 
 #endif // RECORD_H
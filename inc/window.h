@@ -10,12 +10,16 @@
 #ifndef WINDOW_H
 #define WINDOW_H
 
+#include <algorithm>
+#include <cctype>
 #include <functional>
 #include <memory>
 
 #include <ncursesw/ncurses.h>
 
 #include <editor.h>
+#include <event_loop.h>
+#include <render.h>
 #include <quiz.h>
 #include <voice.h>
 #include <viewer.h>
@@ -24,6 +28,25 @@ namespace view {
 
 namespace ncurses {
 
+// codes of the bracketed paste marks, defined for the sequences of the terminal
+const int KEY_PASTE_BEGIN = KEY_MAX + 1;
+const int KEY_PASTE_END = KEY_MAX + 2;
+
+// a character or a function key of ncurses: KEY_F(2), KEY_BACKSPACE, ...,
+// their codes overlap with the code points; or a pasted text
+struct Key
+{
+	enum class Type { NONE, CHARACTER, FUNCTION, TEXT };
+
+	Type type = Type::NONE;
+	wint_t code = 0;
+	std::string text; // utf8, of TEXT
+
+	bool none() const { return type == Type::NONE; }
+	bool is(int function) const { return type == Type::FUNCTION && code == static_cast<wint_t>(function); }
+	bool is_char(wchar_t c) const { return type == Type::CHARACTER && code == static_cast<wint_t>(c); }
+};
+
 enum CLR_SCHEME {
 	BLUE = 1,
 	WHITE,
@@ -64,6 +87,8 @@ protected:
 	Mode mode = Mode::WAIT;
 	WINDOW *window = NULL;
 	Geometry geometry = { -1 , -1 , -1 , -1 };
+	Frame frame;
+	Viewport view; // of the content lines, above the separator
 
 	void create();
 	void remove();
@@ -74,6 +99,19 @@ public:
 	virtual void clear();
 	virtual void refresh();
 	virtual void resize(const Geometry g);
+	// draws the changed lines, the terminal is updated by doupdate
+	virtual void stage();
+
+	void scroll_by(long lines) {
+		view.scroll_by(lines);
+		refresh();
+	}
+
+	// -1 - up, 1 - down
+	void page(int direction) {
+		view.page(direction);
+		refresh();
+	}
 };
 
 
@@ -83,14 +121,25 @@ class CursorWindow : public Window
 
 	std::function<void()> resize_handle;
 
+	Key read_key(int timeout);
+
 protected:
+	tasks::EventLoop& loop; // of the input, the timers and the completions
+
 	void update_cursor(Point position) { cursor = position; }
 
 public:
-	CursorWindow(const std::function<void()>& resize)
+	CursorWindow(tasks::EventLoop& loop, const std::function<void()>& resize)
 		: resize_handle(resize)
+		, loop(loop)
 	{}
 
+	void stage() override {
+		frame.commit(window);
+		wmove(window, cursor.y, cursor.x);
+		wnoutrefresh(window);
+	}
+
 	void focus(bool focused, bool show_cursor = true) {
 		keypad(window, focused ? TRUE : FALSE);
 		if (!focused) return;
@@ -99,17 +148,10 @@ public:
 		wmove(window, cursor.y, cursor.x);
 	}
 
-	int get_key() {
-		for (;;) {
-			int key = wgetch(window);
-			if (key == ERR)
-				throw std::runtime_error("CursorWindow: wgetch error");
-			if (key == KEY_RESIZE)
-				resize_handle();
-			else
-				return key;
-		}
-	}
+	// waits in the loop, returns no key after 'timeout' milliseconds or when a handler
+	// of the loop has run; a character comes whole, the multibyte sequences are decoded
+	// by ncurses. a paste, or the typed characters already waiting, come as one not empty text
+	Key get_key(int timeout = -1);
 };
 
 
@@ -118,30 +160,47 @@ class AnswerWindow : public CursorWindow
 	int tab_size;
 	std::unique_ptr<Editor> editor;
 
-	analysis::Verification verification;
+	std::shared_ptr<const analysis::Verification> verification;
+	Screen::LiveCheck live_check;
+	std::shared_ptr<AudioRecord::Transcript> transcript; // of the phrase being recognized
+	size_t transcript_x = 0, transcript_y = 0, transcript_length = 0; // in the editor
 
 	void update_window();
 	void update_line();
+	void draw_line(size_t y, int row);
+	// the line of the cursor after an edit
+	void update_edited(bool was_empty);
+	// the line of the cursor is kept visible
+	void place_cursor();
+	template <typename Errors>
+	void draw_errors(size_t y, int row, std::string_view line, const Errors& errors);
 
 public:
-	AnswerWindow(const std::function<void()>& resize, int tab_size_)
-		: CursorWindow(resize)
+	AnswerWindow(tasks::EventLoop& loop, const std::function<void()>& resize, int tab_size_)
+		: CursorWindow(loop, resize)
 		, tab_size(tab_size_)
 		, editor(new Editor(tab_size))
 	{}
+	~AnswerWindow();
 
 	virtual void refresh();
-	void key_process(int ch);
+	void key_process(const Key& key);
 
 	void prepare();
-	std::list<std::string> get_lines();
-	void show_analysed(const analysis::Verification& v);
+	// puts the last hypothesis of the phrase being recognized to the editor,
+	// returns the error of the capture, if it has failed
+	std::string poll_capture();
+	void set_live_check(const Screen::LiveCheck& check) { live_check = check; }
+	void get_lines(analysis::AnswerLines& lines);
+	void show_analysed(const std::shared_ptr<const analysis::Verification>& v);
 };
 
 
 class StatisticWindow : public Window
 {
 	Statistics statistics;
+	// of the problem in seconds, the clock is hidden before the first problem
+	int elapsed = -1, limit = 0;
 
 public:
 	virtual void refresh();
@@ -150,21 +209,26 @@ public:
 		statistics = s;
 		refresh();
 	}
+
+	// 'limit' 0 is no limit
+	void set_clock(int elapsed_seconds, int limit_seconds) {
+		elapsed = elapsed_seconds;
+		limit = limit_seconds;
+		refresh();
+	}
 };
 
 
 class QuestionWindow : public Window
 {
-	std::list<std::string> question;
+	SharedLines question; // of the problem, none if it's hidden
 
 public:
 	virtual void refresh();
 
 	void update(const Problem& p) {
-		if (p.not_show_question)
-			question.clear();
-		else
-			question = p.question();
+		question = p.not_show_question ? nullptr : p.shared_question();
+		view.top();
 		refresh();
 	}
 };
@@ -172,7 +236,7 @@ public:
 
 class SolutionWindow : public Window
 {
-	std::list<std::string> solution;
+	SharedLines solution;
 	bool visible = false;
 
 public:
@@ -184,7 +248,8 @@ public:
 	}
 
 	void update(const Problem& p) {
-		solution = p.solution();
+		solution = p.shared_solution();
+		view.top();
 		refresh();
 	}
 };
@@ -197,9 +262,9 @@ class MessageWindow : public Window
 	utils::Language language;
 
 	std::string lang_to_str() {
-		if (language == utils::Language::RU) return "RU";
-		if (language == utils::Language::EN) return "EN";
-		return std::string();
+		std::string code = utils::language_code(language);
+		std::transform(code.begin(), code.end(), code.begin(), ::toupper);
+		return code;
 	}
 
 public:
@@ -8,224 +8,483 @@
  */
 
 #include <algorithm>
-#include <set>
+#include <atomic>
+#include <cctype>
+#include <exception>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
 #include <analyzer.h>
 #include <options.h>
+#include <pattern.h>
 #include <utils.h>
 
 namespace analysis {
 
 #define TAB_WIDTH 4
 
-static
-Token::WHAT what_token(char16_t c)
+// token type of every byte, it's looked up for every symbol of an answer
+struct TokenTable
 {
-	static const std::set<char16_t> space_tokens = { ' ', '\t' };
-	static const std::set<char16_t> punctuate_tokens
-		= { ',', '.', '?', '!', '-', ':', ';', '_', '(', ')',
-			'[', ']', '<', '>', '{', '}', '+', '-', '=', '*', '/' };
-	static const std::set<char16_t> delimeter_tokens
-		= { ',', '.', '?', '!', ':', ';' };
-
-	if (space_tokens.find(c) != space_tokens.end())
-		return Token::SPACE;
-
-	if (punctuate_tokens.find(c) != punctuate_tokens.end()) {
-		int result = Token::PUNCT;
-		if (delimeter_tokens.find(c) != delimeter_tokens.end())
-			result |= Token::DELIM;
-		return (Token::WHAT)result;
+	Token::WHAT what[256];
+
+	constexpr TokenTable() : what() {
+		for (int c = 0; c < 256; ++c)
+			what[c] = Token::WORD;
+
+		what[static_cast<unsigned char>(' ')] = Token::SPACE;
+		what[static_cast<unsigned char>('\t')] = Token::SPACE;
+		for (char c: std::string_view("_()[]<>{}+-=*/"))
+			what[static_cast<unsigned char>(c)] = Token::PUNCT;
+		for (char c: std::string_view(",.?!:;"))
+			what[static_cast<unsigned char>(c)] = static_cast<Token::WHAT>(Token::PUNCT | Token::DELIM);
 	}
+};
+
+static constexpr TokenTable TOKEN_TABLE;
 
-	return Token::WORD;
+static inline
+Token::WHAT what_token(char c)
+{
+	return TOKEN_TABLE.what[static_cast<unsigned char>(c)];
 }
 
-std::list<Token> Analyzer::split_to_tokens(const std::string& s)
+// spaces and punctuation are ASCII, so every byte of a multibyte symbol is a word one
+Tokens Analyzer::split_to_tokens(std::string_view s, std::pmr::memory_resource* resource)
 {
-	std::list<Token> tokens;
+	Tokens tokens(resource);
 	if (s.empty()) return tokens;
 
-	std::u16string token_str;
-	size_t position = 0;
+	if (!utils::is_valid_utf8(s))
+		throw std::runtime_error("invalid utf8 symbol");
+
+	size_t position = 0, token_begin = 0;
+	for (size_t c = 0; c < s.size(); ++c) {
+		Token::WHAT token_type = what_token(s[c]);
+		Token::WHAT token_type_next = c + 1 < s.size() ? what_token(s[c + 1]) : Token::UNDEF;
+		if (token_type == token_type_next)
+			continue;
+
+		// a run of spaces or punctuation is kept as its last symbol
+		std::string_view token_str = token_type == Token::WORD
+			? s.substr(token_begin, c + 1 - token_begin)
+			: s.substr(c, 1);
+		tokens.push_back({ token_type, token_str, position });
+		position += token_type == Token::WORD ? utils::utf8_length(token_str) : c + 1 - token_begin;
+		token_begin = c + 1;
+	}
 
-	std::u16string line = utils::to_utf16(s);
-	std::u16string::iterator c = line.begin(), next = std::next(line.begin());
-	for (; c != line.end(); ++c, ++next) {
-		Token::WHAT token_type = what_token(*c);
-		if (token_type == Token::WORD)
-			token_str.push_back(*c);
-		else
-			token_str = *c;
+	return tokens;
+}
 
-		Token::WHAT token_type_next = next != line.end() ? what_token(*next) : Token::UNDEF;
-		if (token_type != token_type_next) {
-			tokens.push_back({ token_type, token_str, position});
-			position += token_str.length();
-			token_str.clear();
-		}
+template <int OPTIONS>
+Tokens Analyzer::tokens(std::string_view s, std::pmr::string& folded)
+{
+	// folding keeps the code points number, so positions of the tokens are the same
+	if constexpr ((OPTIONS & CASE_UNSENSITIVE) != 0) {
+		folded.assign(s.begin(), s.end());
+		utils::fold_case(folded);
+		s = folded;
 	}
 
+	Tokens tokens = split_to_tokens(s, folded.get_allocator().resource());
+	auto removed = [](const Token& t) {
+		if constexpr ((OPTIONS & PUNCT_UNSENSITIVE) != 0)
+			return t.what == Token::SPACE || (t.what & Token::PUNCT);
+		else
+			return t.what == Token::SPACE;
+	};
+	tokens.erase(std::remove_if(tokens.begin(), tokens.end(), removed), tokens.end());
+
 	return tokens;
 }
 
+Tokens Analyzer::tokens(std::string_view s, int options, std::pmr::string& folded)
+{
+	switch (options & (CASE_UNSENSITIVE | PUNCT_UNSENSITIVE)) {
+	case CASE_UNSENSITIVE:
+		return tokens<CASE_UNSENSITIVE>(s, folded);
+	case PUNCT_UNSENSITIVE:
+		return tokens<PUNCT_UNSENSITIVE>(s, folded);
+	case CASE_UNSENSITIVE | PUNCT_UNSENSITIVE:
+		return tokens<CASE_UNSENSITIVE | PUNCT_UNSENSITIVE>(s, folded);
+	default:
+		return tokens<NONE>(s, folded);
+	}
+}
+
+// phrases are the texts between delimiters, the same as concatenated non-delimiter tokens
+// of split_to_tokens: only the last symbol of a space or punctuation run is kept
+template <typename String, typename F>
 static
-Verification total_recall_check(Verification& v, bool case_unsensitive)
+void for_each_phrase(std::string_view line, String& phrase, F f)
 {
-	std::set<std::string> recall_answ_set;
-	std::set<std::string> recall_solut_set;
-
-	auto remove_space = [](const Token& l){ return l.what == Token::SPACE; };
-	auto downcase = [](Token& l) { utils::to_lower(l.str); return l; };
-	auto split_to_phrases = [] (std::set<std::string>& set, const std::list<Token>& tokens) {
-		std::string phrase;
-		std::list<Token>::const_iterator it = tokens.begin(), next = std::next(tokens.begin());
-		for (; it != tokens.end(); ++it, ++next) {
-			if (it->what & Token::WHAT::DELIM)
-				continue;
-
-			phrase.append(utils::to_utf8(it->str));
-			if (next == tokens.end() || (next->what & Token::WHAT::DELIM)) {
-				utils::trim_spaces(phrase);
-				set.insert(phrase);
-				phrase.clear();
-			}
-		}
+	auto is_space = [](char c) { return c > 0 && std::isspace(c); };
+	auto flush = [&phrase, &f, is_space]() {
+		size_t begin = 0, end = phrase.size();
+		while (begin < end && is_space(phrase[begin]) && phrase[begin] != '\t') ++begin;
+		while (end > begin && is_space(phrase[end - 1])) --end;
+		f(std::string_view(phrase).substr(begin, end - begin));
 	};
 
+	phrase.clear();
+	bool any_token = false;
+	for (size_t i = 0; i < line.size(); ++i) {
+		Token::WHAT type = what_token(line[i]);
+		if (type & Token::DELIM) {
+			if (any_token) flush();
+			phrase.clear();
+			any_token = false;
+			continue;
+		}
 
-	auto analyze_lines = [case_unsensitive, remove_space, downcase, split_to_phrases]
-			(std::set<std::string>& set, const std::list<std::string> &lines)
-	{
-		for (auto line = lines.cbegin(); line != lines.cend(); ++line) {
-			std::list<Token> tokens = Analyzer::split_to_tokens(*line);
+		any_token = true;
+		if (type != Token::WORD && i + 1 < line.size() && what_token(line[i + 1]) == type)
+			continue;
 
-			if (case_unsensitive)
-				std::transform(tokens.begin(), tokens.end(), tokens.begin(), downcase);
+		phrase.push_back(line[i]);
+	}
 
-			split_to_phrases(set, tokens);
-		}
+	if (any_token) flush();
+}
+
+// downcased copy of the line for case unsensitive mode
+template <typename String>
+static
+std::string_view phrases_line(std::string_view line, String& buffer, bool case_unsensitive)
+{
+	if (!case_unsensitive)
+		return line;
+
+	buffer.assign(line.begin(), line.end());
+	utils::fold_case(buffer);
+	return buffer;
+}
+
+// trims spaces, except the leading tabs, and removes duplicate ones,
+// the same as utils::trim_spaces and utils::remove_duplicate_spaces
+static
+void prepare_line(std::string_view line, std::pmr::string& out)
+{
+	auto is_space = [](char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; };
+	size_t begin = 0, end = line.size();
+	while (begin < end && is_space(line[begin]) && line[begin] != '\t') ++begin;
+	while (end > begin && is_space(line[end - 1])) --end;
+
+	out.clear();
+	out.reserve(end - begin);
+	for (size_t i = begin; i < end; ++i)
+		if (line[i] != ' ' || out.empty() || out.back() != ' ')
+			out.push_back(line[i]);
+
+	// solutions are normalized by the parser
+	utils::normalize(out);
+}
+
+static
+int analysis_options(const Options& options)
+{
+	int result = Analyzer::NONE;
+	if (options.get(Options::ANALYSIS_CASE_UNSENSITIVE))
+		result |= Analyzer::CASE_UNSENSITIVE;
+	if (options.get(Options::ANALYSIS_PUNTCTUATION_UNSENSITIVE))
+		result |= Analyzer::PUNCT_UNSENSITIVE;
+	if (options.get(Options::ANALYSIS_TOTAL_RECALL))
+		result |= Analyzer::TOTAL_RECALL;
+	return result;
+}
+
+static
+double fuzzy_threshold(const Options& options)
+{
+	return options.get(Options::ANALYSIS_FUZZY) ? options.fuzzy_threshold() : 0;
+}
+
+struct Analyzer::CompiledSolution
+{
+	// the compiled lines, to tell the solutions with the same hash apart
+	std::list<std::string> source;
+	// total recall mode
+	PhraseSet phrases;
+	// others, pattern per solution line
+	std::vector<Pattern> lines;
+	// check specialized for the options of the solution
+	Verify verify;
+};
+
+Analyzer::Analyzer() = default;
+Analyzer::~Analyzer() = default;
+
+const Analyzer::CompiledSolution& Analyzer::compiled(const std::list<std::string>& solution, int options)
+{
+	const SolutionKey key(utils::hash_lines(solution), options);
+	for (auto [it, end] = solutions.equal_range(key); it != end; ++it)
+		if (it->second->source == solution)
+			return *it->second;
+
+	// indexed by OPTIONS
+	static const Verify VERIFIERS[] = {
+		&verify<NONE>,
+		&verify<CASE_UNSENSITIVE>,
+		&verify<PUNCT_UNSENSITIVE>,
+		&verify<CASE_UNSENSITIVE | PUNCT_UNSENSITIVE>,
+		&verify<TOTAL_RECALL>,
+		&verify<TOTAL_RECALL | CASE_UNSENSITIVE>,
+		&verify<TOTAL_RECALL | PUNCT_UNSENSITIVE>,
+		&verify<TOTAL_RECALL | CASE_UNSENSITIVE | PUNCT_UNSENSITIVE>
 	};
 
-	analyze_lines(recall_answ_set, v.answer);
-	analyze_lines(recall_solut_set, v.solution);
+	std::unique_ptr<CompiledSolution> compiled(new CompiledSolution());
+	compiled->source = solution;
+	compiled->verify = VERIFIERS[options];
+	if (options & TOTAL_RECALL) {
+		PhraseSet& set = compiled->phrases;
+		std::string phrase, buffer;
+		for (const std::string& line: solution)
+			for_each_phrase(phrases_line(line, buffer, options & CASE_UNSENSITIVE), phrase,
+				[&set](std::string_view p) { set.phrases.emplace_back(p); });
+
+		std::sort(set.phrases.begin(), set.phrases.end());
+		set.phrases.erase(std::unique(set.phrases.begin(), set.phrases.end()), set.phrases.end());
+
+		set.ids.reserve(set.phrases.size());
+		for (size_t id = 0; id < set.phrases.size(); ++id)
+			set.ids.emplace(set.phrases[id], id);
+	} else {
+		compiled->lines.reserve(solution.size());
+		for (const std::string& line: solution)
+			compiled->lines.emplace_back(line, options);
+	}
 
-	std::vector<std::string> wrong, missed;
-	std::set_difference(
-		recall_answ_set.cbegin(), recall_answ_set.cend(),
-		recall_solut_set.cbegin(), recall_solut_set.cend(),
-		std::inserter(wrong, wrong.begin()));
+	return *solutions.emplace(key, std::move(compiled))->second;
+}
 
-	std::set_difference(
-		recall_solut_set.cbegin(), recall_solut_set.cend(),
-		recall_answ_set.cbegin(), recall_answ_set.cend(),
-		std::inserter(missed, missed.begin()));
+void Analyzer::prepare(const Problem& problem, const Options& options)
+{
+	int analysis = analysis_options(options);
+	bool inverted = options.get(Options::QS_INVERTED);
+
+	// solution() depends on the current inversion of the problem
+	compiled(problem.inverted == inverted ? problem.solution() : problem.question(), analysis);
+	if (options.get(Options::QS_MIXED))
+		compiled(problem.inverted == inverted ? problem.question() : problem.solution(), analysis);
+}
+
+static
+void total_recall_check(Verification& v, const PhraseSet& solution_set, bool case_unsensitive)
+{
+	std::pmr::memory_resource* arena = v.answer.get_allocator().resource();
+	std::pmr::vector<bool> recalled(solution_set.phrases.size(), false, arena);
+	std::pmr::vector<std::pmr::string> wrong(arena);
+
+	std::pmr::string phrase(arena), buffer(arena);
+	for (const std::pmr::string& line: v.answer)
+		for_each_phrase(phrases_line(line, buffer, case_unsensitive), phrase,
+			[&](std::string_view p) {
+				auto it = solution_set.ids.find(p);
+				if (it != solution_set.ids.end())
+					recalled[it->second] = true;
+				else
+					wrong.emplace_back(p);
+			});
+
+	std::sort(wrong.begin(), wrong.end());
+	wrong.erase(std::unique(wrong.begin(), wrong.end()), wrong.end());
+
+	auto& report = v.report;
+	auto append_phrase = [&report](std::string_view p) {
+		if (report.back().size() > 80) report.emplace_back("");
+		report.back().append(p).append(", ");
+	};
 
-	std::list<std::string> solution;
 	if (!wrong.empty()) {
-		solution.push_back("Wrong:");
-		solution.push_back("");
-		for (const std::string &w: wrong) {
-			if (solution.back().size() > 80) solution.push_back("");
-			solution.back().append(w + ", ");
-		}
-		solution.push_back("");
+		report.emplace_back("Wrong:");
+		report.emplace_back("");
+		for (const std::pmr::string &w: wrong)
+			append_phrase(w);
+		report.emplace_back("");
 	}
 
-	if (!missed.empty()) {
-		solution.push_back("Missed:");
-		solution.push_back("");
-		for (const std::string &m: missed) {
-			if (solution.back().size() > 80) solution.push_back("");
-			solution.back().append(m + ", ");
+	// ids are given in sorted order, so missed phrases are sorted too
+	bool any_missed = false;
+	for (size_t id = 0; id < recalled.size(); ++id) {
+		if (recalled[id])
+			continue;
+
+		if (!any_missed) {
+			report.emplace_back("Missed:");
+			report.emplace_back("");
+			any_missed = true;
 		}
+		append_phrase(solution_set.phrases[id]);
 	}
 
-	if (!solution.empty()) {
+	if (!report.empty())
 		v.state |= MARK::ERROR;
-		v.solution =  solution;
-	}
+}
 
-	return v;
+// normalized edit distance of the words is within the threshold
+static
+bool near_miss(std::string_view answer, std::string_view solution, double threshold)
+{
+	if (threshold <= 0)
+		return false;
+
+	std::u32string a = utils::to_utf32(answer), s = utils::to_utf32(solution);
+	size_t max_distance = static_cast<size_t>(threshold * std::max(a.size(), s.size()));
+	if (max_distance == 0)
+		return false;
+
+	return utils::edit_distance(a, s, max_distance) <= max_distance;
+}
+
+Verification Analyzer::check(const Problem& problem, const AnswerLines& answer, const Options& options,
+	std::pmr::memory_resource* arena)
+{
+	const CompiledSolution& solution = compiled(problem.solution(), analysis_options(options));
+	return solution.verify(answer, solution, fuzzy_threshold(options), arena);
 }
 
 Verification Analyzer::check(
 	const Problem& problem, const std::list<std::string>& answer, const Options& options)
 {
-	Verification v(problem, answer);
-	v.answer.remove("");
+	return check(problem, AnswerLines(answer.begin(), answer.end()), options);
+}
 
-	std::for_each(v.answer.begin(), v.answer.end(), utils::trim_spaces);
-	std::for_each(v.answer.begin(), v.answer.end(), utils::remove_duplicate_spaces);
+std::vector<Verification> Analyzer::check(
+	const std::vector<Submission>& submissions, const Options& options, unsigned threads)
+{
+	// submissions are taken by workers in chunks, to not contend for the counter
+	static const size_t CHUNK = 64;
+
+	int analysis = analysis_options(options);
+	double threshold = fuzzy_threshold(options);
+
+	// the cache is filled before the workers start, they read the compiled solutions only
+	std::vector<const CompiledSolution*> compiled_solutions;
+	compiled_solutions.reserve(submissions.size());
+	for (const Submission& s: submissions)
+		compiled_solutions.push_back(&compiled(s.problem->solution(), analysis));
+
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	threads = static_cast<unsigned>(std::min<size_t>(threads, (submissions.size() + CHUNK - 1) / CHUNK));
+
+	std::vector<Verification> results(submissions.size());
+	std::vector<std::exception_ptr> failures(threads);
+	std::atomic<size_t> next_chunk(0);
+
+	auto worker = [&](unsigned worker_num) {
+		try {
+			size_t begin;
+			while ((begin = next_chunk.fetch_add(CHUNK)) < submissions.size()) {
+				size_t end = std::min(begin + CHUNK, submissions.size());
+				for (size_t i = begin; i < end; ++i) {
+					const CompiledSolution& solution = *compiled_solutions[i];
+					results[i] = solution.verify(AnswerLines(submissions[i].answer.begin(),
+						submissions[i].answer.end()), solution, threshold, std::pmr::get_default_resource());
+				}
+			}
+		} catch (...) {
+			failures[worker_num] = std::current_exception();
+			next_chunk = submissions.size();
+		}
+	};
 
-	if (options.get(Options::ANALYSIS_TOTAL_RECALL))
-		return total_recall_check(v, options.get(Options::ANALYSIS_CASE_UNSENSITIVE));
+	// the calling thread is one of the workers
+	std::vector<std::thread> pool;
+	for (unsigned t = 1; t < threads; ++t)
+		pool.emplace_back(worker, t);
+	if (threads != 0)
+		worker(0);
+
+	for (std::thread& t: pool)
+		t.join();
+
+	for (const std::exception_ptr& failure: failures)
+		if (failure)
+			std::rethrow_exception(failure);
 
-	int line_num = 0;
+	return results;
+}
+
+template <int OPTIONS>
+Verification Analyzer::verify(const AnswerLines& answer, const CompiledSolution& solution,
+	double fuzzy_threshold, std::pmr::memory_resource* arena)
+{
+	Verification v(arena);
+	v.answer.reserve(answer.size());
+	for (std::string_view line: answer) {
+		if (line.empty())
+			continue;
+		v.answer.emplace_back();
+		prepare_line(line, v.answer.back());
+	}
+
+	if constexpr ((OPTIONS & TOTAL_RECALL) != 0) {
+		total_recall_check(v, solution.phrases, (OPTIONS & CASE_UNSENSITIVE) != 0);
+		return v;
+	}
+
+	std::pmr::string folded(arena);
+	size_t line_num = 0;
 	auto answr_line = v.answer.cbegin();
-	auto solut_line = v.solution.cbegin();
-	for (; answr_line != v.answer.cend() && solut_line != v.solution.cend()
+	auto solut_line = solution.lines.cbegin();
+	for (; answr_line != v.answer.cend() && solut_line != solution.lines.cend()
 		 ; ++answr_line, ++solut_line, ++line_num)
 	{
-		auto answr_tokens = split_to_tokens(*answr_line);
-		auto solut_tokens = split_to_tokens(*solut_line);
-
-		auto remove_space = [](const Token& l){ return l.what == Token::SPACE; };
-		answr_tokens.remove_if(remove_space);
-		solut_tokens.remove_if(remove_space);
+		const std::pmr::string& line = *answr_line;
+		// 'length' symbols from 'pos' of the line
+		auto push_error = [&v, &line, line_num](Error::WHAT what, size_t pos, size_t length) {
+			size_t offset = utils::utf8_offset(line, pos);
+			v.errors.push_back({ what, line_num, pos, offset, utils::utf8_offset(line, pos + length) - offset });
+		};
 
-		if (options.get(Options::ANALYSIS_CASE_UNSENSITIVE)) {
-			auto downcase = [](Token& l) { utils::to_lower(l.str); return l; };
-			std::transform(answr_tokens.begin(), answr_tokens.end(), answr_tokens.begin(), downcase);
-			std::transform(solut_tokens.begin(), solut_tokens.end(), solut_tokens.begin(), downcase);
-		}
+		Tokens answr_tokens = tokens<OPTIONS>(line, folded);
+		if (solut_line->match(answr_tokens))
+			continue;
 
-		if (options.get(Options::ANALYSIS_PUNTCTUATION_UNSENSITIVE)) {
-			auto remove_punctuation = [](const Token& l){ return l.what & Token::PUNCT; };
-			answr_tokens.remove_if(remove_punctuation);
-			solut_tokens.remove_if(remove_punctuation);
-		}
+		// errors are reported against the closest alternative
+		Tokens solut_tokens = solut_line->closest(answr_tokens);
 
 		auto answr_token = answr_tokens.cbegin();
 		auto solut_token = solut_tokens.cbegin();
 		for (; answr_token != answr_tokens.cend() && solut_token != solut_tokens.cend()
 			 ; ++answr_token, ++solut_token)
 		{
-			std::u16string answr = answr_token->str;
-			std::u16string solut = solut_token->str;
+			std::string_view answr = answr_token->str;
+			std::string_view solut = solut_token->str;
 			size_t pos = answr_token->pos;
 
-			std::u16string answr_next;
 			auto answr_it_next = std::next(answr_token);
-			if (answr_it_next != answr_tokens.cend())
-				answr_next = answr_it_next->str;
+			std::string_view answr_next = answr_it_next != answr_tokens.cend() ? answr_it_next->str : "";
 
-			std::u16string solut_next;
 			auto solut_it_next = std::next(solut_token);
-			if (solut_it_next != solut_tokens.cend())
-				solut_next = solut_it_next->str;
+			std::string_view solut_next = solut_it_next != solut_tokens.cend() ? solut_it_next->str : "";
 
 			if (answr != solut) {
 				if (pos != 0 && answr == solut_next) { // token missed in answer
 					++solut_token;
-					v.errors[line_num].push_back({Error::MISSED, utils::to_utf16(" "), pos - 1});
+					push_error(Error::MISSED, pos - 1, 1);
 				} else if (answr_next == solut) { // redundant token in answer
 					++answr_token;
-					v.errors[line_num].push_back({Error::REDUNDANT, answr, pos});
+					push_error(Error::REDUNDANT, pos, utils::utf8_length(answr));
+				} else if (near_miss(answr, solut, fuzzy_threshold)) {
+					push_error(Error::NEAR_MISS, pos, utils::utf8_length(answr));
+					v.state |= MARK::NEAR_MISS;
+					continue;
 				} else { // error token
-					v.errors[line_num].push_back({Error::ERROR_TOKEN, answr, pos});
+					push_error(Error::ERROR_TOKEN, pos, utils::utf8_length(answr));
 
-					for (size_t i = 0; i < answr.size() && i < solut.size(); ++i)
-						if (answr.at(i) != solut.at(i)) {
-							v.errors[line_num].push_back(
-								{Error::ERROR_SYMBOL, std::u16string(1, answr.at(i)), pos + i});
-						}
+					size_t a = 0, s = 0, i = 0;
+					for (; a < answr.size() && s < solut.size(); ++i)
+						if (utils::next_code_point(answr, a) != utils::next_code_point(solut, s))
+							push_error(Error::ERROR_SYMBOL, pos + i, 1);
 
 					// different length
-					if (solut.size() < answr.size())
-						v.errors[line_num].push_back(
-							{Error::ERROR_SYMBOL, answr.substr(solut.size()), pos + solut.size()});
+					if (a < answr.size())
+						push_error(Error::ERROR_SYMBOL, pos + i, utils::utf8_length(answr.substr(a)));
 				}
 				v.state |= MARK::ERROR;
 			}
@@ -233,25 +492,104 @@ Verification Analyzer::check(
 
 		// not full answer
 		if (solut_token != solut_tokens.cend()) {
-			v.errors[line_num].push_back(
-				{Error::MISSED, utils::to_utf16("..."), utils::to_utf16(*answr_line).size()});
+			push_error(Error::MISSED, utils::utf8_length(line), 0);
 			v.state |= MARK::NOT_FULL_ANSWER;
 		}
 
 		// redundant answer
 		if (answr_token != answr_tokens.cend()) {
 			for (; answr_token != answr_tokens.cend(); ++answr_token)
-				v.errors[line_num].push_back(
-					{Error::REDUNDANT, answr_token->str, answr_token->pos});
+				push_error(Error::REDUNDANT, answr_token->pos, utils::utf8_length(answr_token->str));
 			v.state |= MARK::REDUNDANT_ANSWER;
 		}
 	}
 
-	if(options.get(Options::ANALYSIS_TOTAL_RECALL) && v.solution.size() != v.answer.size())
-		v.state |= MARK::INVALID_LINES_NUMBER;
-
 	return v;
 }
 
+LiveCheck::LiveCheck(Analyzer& analyzer, const Problem& problem, const Options& options)
+	: patterns(nullptr)
+	, options(analysis_options(options))
+{
+	if (!(this->options & Analyzer::TOTAL_RECALL))
+		patterns = &analyzer.compiled(problem.solution(), this->options).lines;
+}
+
+LiveCheck::~LiveCheck() = default;
+
+const std::vector<Error>& LiveCheck::update(size_t line_num, std::string_view text)
+{
+	if (line_num >= lines.size())
+		lines.resize(line_num + 1);
+
+	// the verification skips the empty lines, so they have no line of the solution
+	size_t solution_line = std::count_if(lines.cbegin(), lines.cbegin() + line_num,
+		[](const Line& l) { return !l.text.empty(); });
+
+	Line& line = lines[line_num];
+	if (solution_line != line.solution_line) {
+		line.tokens.clear();
+		line.errors.clear();
+		line.solution_line = solution_line;
+	} else if (text == line.text)
+		return line.errors;
+
+	if (!patterns || text.empty() || solution_line >= patterns->size() || !utils::is_valid_utf8(text)) {
+		line.text.assign(text);
+		line.tokens.clear();
+		line.errors.clear();
+		return line.errors;
+	}
+
+	// tokens starting inside the common prefix are kept with the states after them
+	size_t common = std::mismatch(text.begin(), text.begin() + std::min(text.size(), line.text.size()),
+		line.text.begin()).first - text.begin();
+	size_t common_symbols = utils::utf8_length(text.substr(0, common));
+
+	size_t kept = 0;
+	while (kept < line.tokens.size() && line.tokens[kept].pos < common_symbols)
+		++kept;
+
+	// the last token starting in the prefix may continue after it
+	size_t tail_pos = 0;
+	if (kept != 0)
+		tail_pos = line.tokens[--kept].pos;
+
+	line.text.assign(text);
+	line.tokens.resize(kept);
+
+	const Pattern& pattern = (*patterns)[solution_line];
+	size_t state = kept != 0 ? line.tokens.back().state : Pattern::START;
+	size_t text_length = utils::utf8_length(text);
+
+	Tokens tail = Analyzer::tokens(text.substr(utils::utf8_offset(text, tail_pos)), options, line.folded);
+	for (size_t i = 0; i < tail.size(); ++i) {
+		size_t pos = tail_pos + tail[i].pos;
+		size_t length = utils::utf8_length(tail[i].str);
+
+		bool right;
+		size_t next = pattern.advance(state, tail[i].str, right);
+		// the last token may be typed not completely, it is always in the tail
+		if (!right && i + 1 == tail.size() && pos + length == text_length)
+			right = pattern.continues(state, tail[i].str);
+
+		line.tokens.push_back({ pos, length, right, next });
+		state = next;
+	}
+
+	// errors are shown over the typed text, so they keep its case
+	line.errors.clear();
+	for (const LineToken& t: line.tokens) {
+		if (t.right)
+			continue;
+
+		size_t offset = utils::utf8_offset(text, t.pos);
+		line.errors.push_back({ Error::ERROR_TOKEN, line_num, t.pos, offset,
+			utils::utf8_offset(text, t.pos + t.length) - offset });
+	}
+
+	return line.errors;
+}
+
 } // namespace analysis
 
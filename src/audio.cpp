@@ -0,0 +1,216 @@
+/*
+ * audio.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include <thread>
+
+#include <audio.h>
+
+namespace audio {
+
+namespace {
+
+// WAV fields are little endian
+uint32_t read_le(std::istream& in, int bytes)
+{
+	uint32_t result = 0;
+	for (int i = 0; i < bytes; ++i) {
+		int c = in.get();
+		if (c == EOF)
+			throw std::runtime_error("WavSource: unexpected end of file");
+		result |= static_cast<uint32_t>(c) << (8 * i);
+	}
+	return result;
+}
+
+void write_le(std::ostream& out, uint32_t value, int bytes)
+{
+	for (int i = 0; i < bytes; ++i)
+		out.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+WavSource::WavSource(const std::string& path, bool realtime)
+	: file(path, std::ios::binary)
+	, realtime(realtime)
+{
+	if (!file.is_open())
+		throw std::runtime_error("WavSource: can't open " + path);
+
+	char id[4];
+	file.read(id, 4);
+	if (!file || std::string(id, 4) != "RIFF")
+		throw std::runtime_error("WavSource: not a RIFF file " + path);
+	read_le(file, 4);
+	file.read(id, 4);
+	if (!file || std::string(id, 4) != "WAVE")
+		throw std::runtime_error("WavSource: not a WAVE file " + path);
+
+	bool format = false;
+	for (;;) {
+		file.read(id, 4);
+		if (!file)
+			throw std::runtime_error("WavSource: no data in " + path);
+		uint32_t size = read_le(file, 4);
+		std::string chunk(id, 4);
+
+		if (chunk == "fmt ") {
+			uint32_t encoding = read_le(file, 2);
+			uint32_t channels = read_le(file, 2);
+			rate = static_cast<int>(read_le(file, 4));
+			read_le(file, 4); // byte rate
+			read_le(file, 2); // block align
+			uint32_t bits = read_le(file, 2);
+			if (encoding != 1 || channels != 1 || bits != 16)
+				throw std::runtime_error("WavSource: PCM 16 bit mono only " + path);
+			file.ignore(size - 16 + (size & 1));
+			format = true;
+		} else if (chunk == "data") {
+			if (!format)
+				throw std::runtime_error("WavSource: data before format in " + path);
+			left = size / sizeof(int16_t);
+			return;
+		} else
+			file.ignore(size + (size & 1));
+	}
+}
+
+void WavSource::start()
+{
+	started = now();
+	delivered = 0;
+}
+
+size_t WavSource::read(int16_t* samples, size_t max)
+{
+	size_t n = std::min(max, left);
+	if (n == 0)
+		return 0;
+
+	if (realtime) {
+		if (delivered == 0 && started == 0)
+			start();
+		double due = started + static_cast<double>(delivered + n) / rate;
+		double wait = due - now();
+		if (wait > 0)
+			std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+	}
+
+	for (size_t i = 0; i < n; ++i)
+		samples[i] = static_cast<int16_t>(read_le(file, 2));
+	left -= n;
+	delivered += n;
+	return n;
+}
+
+void write_wav(const std::string& path, const std::vector<int16_t>& samples, int sample_rate)
+{
+	std::ofstream out(path, std::ios::binary);
+	if (!out.is_open())
+		throw std::runtime_error("write_wav: can't create " + path);
+
+	uint32_t data_size = static_cast<uint32_t>(samples.size() * sizeof(int16_t));
+	out.write("RIFF", 4);
+	write_le(out, 36 + data_size, 4);
+	out.write("WAVE", 4);
+	out.write("fmt ", 4);
+	write_le(out, 16, 4);
+	write_le(out, 1, 2); // PCM
+	write_le(out, 1, 2); // mono
+	write_le(out, sample_rate, 4);
+	write_le(out, sample_rate * sizeof(int16_t), 4);
+	write_le(out, sizeof(int16_t), 2);
+	write_le(out, 16, 2);
+	out.write("data", 4);
+	write_le(out, data_size, 4);
+	for (int16_t s: samples)
+		write_le(out, static_cast<uint16_t>(s), 2);
+}
+
+RingBuffer::RingBuffer(size_t capacity)
+	: samples(std::max<size_t>(capacity, 1))
+{
+}
+
+void RingBuffer::push(const int16_t* s, size_t n)
+{
+	// only the last 'capacity' samples are kept
+	if (n > samples.size()) {
+		s += n - samples.size();
+		n = samples.size();
+	}
+
+	for (size_t i = 0; i < n; ++i) {
+		samples[head] = s[i];
+		head = (head + 1) % samples.size();
+	}
+	count = std::min(count + n, samples.size());
+}
+
+void RingBuffer::drain(std::vector<int16_t>& out)
+{
+	size_t first = (head + samples.size() - count) % samples.size();
+	for (size_t i = 0; i < count; ++i)
+		out.push_back(samples[(first + i) % samples.size()]);
+	count = 0;
+}
+
+bool voiced(const int16_t* samples, size_t n, int16_t threshold)
+{
+	if (n == 0)
+		return false;
+
+	uint64_t sum = 0;
+	for (size_t i = 0; i < n; ++i)
+		sum += static_cast<uint64_t>(std::abs(static_cast<int>(samples[i])));
+	return sum / n >= static_cast<uint64_t>(threshold);
+}
+
+VoiceGate::VoiceGate(int sample_rate, int pre_roll_ms, int16_t threshold)
+	: threshold(threshold)
+	, pre_roll(static_cast<size_t>(sample_rate) * pre_roll_ms / 1000)
+{
+}
+
+const std::vector<int16_t>& VoiceGate::feed(const int16_t* samples, size_t n)
+{
+	passed.clear();
+	if (opened) {
+		passed.assign(samples, samples + n);
+		return passed;
+	}
+
+	if (!voiced(samples, n, threshold)) {
+		pre_roll.push(samples, n);
+		return passed;
+	}
+
+	opened = true;
+	pre_roll.drain(passed);
+	passed.insert(passed.end(), samples, samples + n);
+	return passed;
+}
+
+void VoiceGate::reset()
+{
+	opened = false;
+	pre_roll.clear();
+	passed.clear();
+}
+
+} // namespace audio
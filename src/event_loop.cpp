@@ -0,0 +1,141 @@
+/*
+ * event_loop.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <event_loop.h>
+
+namespace tasks {
+
+namespace {
+
+timespec to_timespec(std::chrono::milliseconds ms)
+{
+	timespec result;
+	result.tv_sec = static_cast<time_t>(ms.count() / 1000);
+	result.tv_nsec = static_cast<long>(ms.count() % 1000) * 1000000;
+	return result;
+}
+
+} // namespace
+
+EventLoop::EventLoop()
+	: event_fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+{
+	if (event_fd < 0)
+		throw std::runtime_error(std::string("EventLoop: can't create an eventfd: ") + strerror(errno));
+}
+
+EventLoop::~EventLoop()
+{
+	for (const auto& t: timers)
+		close(t.first);
+	close(event_fd);
+}
+
+void EventLoop::post(Handler handler)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		posted.push_back(std::move(handler));
+	}
+	uint64_t one = 1;
+	if (write(event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+		throw std::runtime_error(std::string("EventLoop: can't wake the loop: ") + strerror(errno));
+}
+
+int EventLoop::add_timer(std::chrono::milliseconds first, std::chrono::milliseconds interval, Handler handler)
+{
+	int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+	if (fd < 0)
+		throw std::runtime_error(std::string("EventLoop: can't create a timer: ") + strerror(errno));
+
+	// a zero time disarms the timer, so the first expiration is at least 1 ns
+	itimerspec spec;
+	spec.it_value = to_timespec(first);
+	if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0)
+		spec.it_value.tv_nsec = 1;
+	spec.it_interval = to_timespec(interval);
+	timerfd_settime(fd, 0, &spec, nullptr);
+
+	timers[fd] = { std::move(handler), interval.count() == 0 };
+	return fd;
+}
+
+void EventLoop::remove_timer(int id)
+{
+	if (timers.erase(id) != 0)
+		close(id);
+}
+
+void EventLoop::run_posted()
+{
+	uint64_t count;
+	if (read(event_fd, &count, sizeof(count)) < 0)
+		return;
+
+	std::vector<Handler> handlers;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		handlers.swap(posted);
+	}
+	for (Handler& h: handlers)
+		if (h) h();
+}
+
+void EventLoop::run_timer(int fd)
+{
+	uint64_t expirations;
+	auto it = timers.find(fd);
+	// removed by a previous handler of the same wait
+	if (it == timers.end() || read(fd, &expirations, sizeof(expirations)) < 0)
+		return;
+
+	Handler handler = it->second.handler;
+	if (it->second.once)
+		remove_timer(fd);
+	handler();
+}
+
+EventLoop::Wake EventLoop::wait(int fd, int timeout_ms)
+{
+	std::vector<pollfd> fds = { { event_fd, POLLIN, 0 } };
+	for (const auto& t: timers)
+		fds.push_back({ t.first, POLLIN, 0 });
+	if (fd >= 0)
+		fds.push_back({ fd, POLLIN, 0 });
+
+	int ready = poll(fds.data(), fds.size(), timeout_ms);
+	if (ready < 0 && errno == EINTR)
+		return Wake::EVENT;
+	if (ready < 0)
+		throw std::runtime_error(std::string("EventLoop: poll error: ") + strerror(errno));
+	if (ready == 0)
+		return Wake::TIMEOUT;
+
+	if (fds[0].revents & POLLIN)
+		run_posted();
+	for (size_t i = 1; i < fds.size() - (fd >= 0 ? 1 : 0); ++i)
+		if (fds[i].revents & POLLIN)
+			run_timer(fds[i].fd);
+
+	if (fd >= 0 && fds.back().revents != 0)
+		return Wake::READABLE;
+	return Wake::EVENT;
+}
+
+} // namespace tasks
@@ -0,0 +1,151 @@
+/*
+ * executor.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+#include <executor.h>
+#include <log.h>
+
+namespace tasks {
+
+namespace {
+
+// a phrase, a save and a prefetch may run at once, the rest waits in the queues
+const unsigned SHARED_THREADS = 3;
+
+} // namespace
+
+struct Token::State
+{
+	std::atomic<bool> cancelled { false };
+
+	mutable std::mutex mutex;
+	mutable std::condition_variable finished;
+	bool done = false;
+};
+
+Token::Token()
+	: state(std::make_shared<State>())
+{
+}
+
+void Token::cancel()
+{
+	state->cancelled = true;
+}
+
+bool Token::cancelled() const
+{
+	return state->cancelled;
+}
+
+bool Token::done() const
+{
+	std::lock_guard<std::mutex> lock(state->mutex);
+	return state->done;
+}
+
+void Token::wait() const
+{
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [this]() { return state->done; });
+}
+
+void Token::finish()
+{
+	std::lock_guard<std::mutex> lock(state->mutex);
+	state->done = true;
+	state->finished.notify_all();
+}
+
+
+Executor::Executor(unsigned threads)
+{
+	for (unsigned i = 0; i < std::max(1u, threads); ++i)
+		workers.emplace_back(&Executor::run, this);
+}
+
+Executor::~Executor()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	queued.notify_all();
+
+	for (std::thread& t: workers)
+		t.join();
+}
+
+Executor& Executor::shared()
+{
+	static Executor executor(SHARED_THREADS);
+	return executor;
+}
+
+Token Executor::submit(Priority priority, Task task, Token token)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queues[static_cast<size_t>(priority)].push_back({ std::move(task), token });
+	}
+	queued.notify_one();
+	return token;
+}
+
+void Executor::wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	idle.wait(lock, [this]() { return running == 0 && empty(); });
+}
+
+bool Executor::empty() const
+{
+	return std::all_of(std::begin(queues), std::end(queues),
+		[](const std::deque<Entry>& q) { return q.empty(); });
+}
+
+void Executor::run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;) {
+		queued.wait(lock, [this]() { return stopping || !empty(); });
+		if (empty())
+			break;
+
+		std::deque<Entry>& queue = *std::find_if(std::begin(queues), std::end(queues),
+			[](const std::deque<Entry>& q) { return !q.empty(); });
+		Entry entry = std::move(queue.front());
+		queue.pop_front();
+		++running;
+		lock.unlock();
+
+		// superseded work is dropped
+		if (!entry.token.cancelled()) {
+			try {
+				entry.task(entry.token);
+			} catch (const std::exception& e) {
+				logging::Error() << "background task has failed: " << e.what() << logging::endl;
+			}
+		}
+
+		// the captures of the task are released before its token is done
+		entry.task = nullptr;
+		entry.token.finish();
+
+		lock.lock();
+		--running;
+		if (running == 0 && empty())
+			idle.notify_all();
+	}
+}
+
+} // namespace tasks
@@ -0,0 +1,414 @@
+/*
+ * grader.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include <grader.h>
+#include <utils.h>
+
+namespace grading {
+
+namespace an = analysis;
+
+namespace {
+
+// lines are checked in batches, so the output is streamed while the input is read
+const size_t BATCH_SIZE = 4096;
+
+// reader of the answer lines, the only values needed are strings, string arrays and numbers
+class JsonReader
+{
+public:
+	JsonReader(const std::string& s) : s(s), pos(0) {}
+
+	void skip_spaces() {
+		while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\r' || s[pos] == '\n'))
+			++pos;
+	}
+
+	bool consume(char c) {
+		skip_spaces();
+		if (pos < s.size() && s[pos] == c) {
+			++pos;
+			return true;
+		}
+		return false;
+	}
+
+	void expect(char c) {
+		if (!consume(c))
+			throw std::runtime_error(std::string("expected '") + c + "'");
+	}
+
+	bool end() {
+		skip_spaces();
+		return pos == s.size();
+	}
+
+	std::string string() {
+		expect('"');
+		std::string result;
+		while (pos < s.size() && s[pos] != '"') {
+			char c = s[pos++];
+			if (c != '\\') {
+				result.push_back(c);
+				continue;
+			}
+
+			if (pos == s.size())
+				break;
+
+			switch (c = s[pos++]) {
+			case 'b': result.push_back('\b'); break;
+			case 'f': result.push_back('\f'); break;
+			case 'n': result.push_back('\n'); break;
+			case 'r': result.push_back('\r'); break;
+			case 't': result.push_back('\t'); break;
+			case 'u': {
+				char32_t code_point = hex4();
+				// surrogate pair
+				if (code_point >= 0xD800 && code_point <= 0xDBFF
+				 && s.compare(pos, 2, "\\u") == 0) {
+					pos += 2;
+					char32_t low = hex4();
+					if (low < 0xDC00 || low > 0xDFFF)
+						throw std::runtime_error("invalid surrogate pair");
+					code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+				} else if (code_point >= 0xD800 && code_point <= 0xDFFF)
+					throw std::runtime_error("invalid surrogate pair");
+				utils::append_utf8(result, code_point);
+				break;
+			}
+			default: result.push_back(c); break; // '"', '\\' and '/'
+			}
+		}
+
+		expect('"');
+		return result;
+	}
+
+	// a string or an array of strings
+	std::list<std::string> lines() {
+		skip_spaces();
+		if (pos < s.size() && s[pos] == '"')
+			return { string() };
+
+		std::list<std::string> result;
+		expect('[');
+		if (consume(']'))
+			return result;
+
+		do {
+			result.push_back(string());
+		} while (consume(','));
+
+		expect(']');
+		return result;
+	}
+
+	long number() {
+		skip_spaces();
+		size_t end = pos;
+		if (end < s.size() && s[end] == '-')
+			++end;
+		size_t digits = end;
+		while (end < s.size() && std::isdigit(static_cast<unsigned char>(s[end])))
+			++end;
+		if (end == digits)
+			throw std::runtime_error("expected a number");
+		if (end < s.size() && std::strchr("-+.eE", s[end]))
+			throw std::runtime_error("invalid number");
+
+		long result;
+		try {
+			result = std::stol(s.substr(pos, end - pos));
+		} catch (const std::out_of_range&) {
+			throw std::runtime_error("number out of range");
+		}
+		pos = end;
+		return result;
+	}
+
+	void skip_value() {
+		skip_spaces();
+		if (pos == s.size())
+			throw std::runtime_error("unexpected end of line");
+
+		char c = s[pos];
+		if (c == '"') {
+			string();
+		} else if (c == '[' || c == '{') {
+			char close = c == '[' ? ']' : '}';
+			++pos;
+			if (consume(close))
+				return;
+			do {
+				if (close == '}') {
+					string();
+					expect(':');
+				}
+				skip_value();
+			} while (consume(','));
+			expect(close);
+		} else {
+			while (pos < s.size() && s[pos] != ',' && s[pos] != '}' && s[pos] != ']')
+				++pos;
+		}
+	}
+
+private:
+	const std::string& s;
+	size_t pos;
+
+	char32_t hex4() {
+		if (pos + 4 > s.size())
+			throw std::runtime_error("invalid \\u escape");
+
+		char32_t result = 0;
+		for (size_t end = pos + 4; pos < end; ++pos) {
+			char c = s[pos];
+			result <<= 4;
+			if (c >= '0' && c <= '9') result |= c - '0';
+			else if (c >= 'a' && c <= 'f') result |= c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F') result |= c - 'A' + 10;
+			else throw std::runtime_error("invalid \\u escape");
+		}
+		return result;
+	}
+};
+
+void append_json_string(std::string& out, std::string_view s)
+{
+	out.push_back('"');
+	for (char c: s) {
+		switch (c) {
+		case '"':  out.append("\\\""); break;
+		case '\\': out.append("\\\\"); break;
+		case '\n': out.append("\\n"); break;
+		case '\r': out.append("\\r"); break;
+		case '\t': out.append("\\t"); break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20) {
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				out.append(escaped);
+			} else
+				out.push_back(c);
+		}
+	}
+	out.push_back('"');
+}
+
+const char* error_name(an::Error::WHAT what)
+{
+	switch (what) {
+	case an::Error::ERROR_TOKEN:  return "error_token";
+	case an::Error::ERROR_SYMBOL: return "error_symbol";
+	case an::Error::MISSED:       return "missed";
+	case an::Error::REDUNDANT:    return "redundant";
+	case an::Error::NEAR_MISS:    return "near_miss";
+	}
+	return "unknown";
+}
+
+// lines are prepared the same way as the parser does with the quiz
+std::list<std::string> prepared(std::list<std::string> lines)
+{
+	for (std::string& line: lines) {
+		utils::trim_spaces(line);
+		utils::remove_duplicate_spaces(line);
+		utils::normalize(line);
+	}
+	return lines;
+}
+
+struct Record
+{
+	size_t line;
+	size_t problem;
+	std::string error; // the line was not graded
+};
+
+class Grader
+{
+public:
+	// with -i the answers are to the inverted problems, the copies share the lines
+	Grader(const std::vector<std::shared_ptr<Problem>>& problems, const Options& options)
+		: options(options)
+	{
+		oriented.reserve(problems.size());
+		for (size_t i = 0; i < problems.size(); ++i) {
+			oriented.push_back(*problems[i]);
+			oriented.back().inverted = options.get(Options::QS_INVERTED);
+			by_question.emplace(utils::hash_lines(oriented.back().question()), i);
+		}
+	}
+
+	void add(const std::string& line, size_t line_num) {
+		Record record = { line_num, 0, "" };
+		try {
+			an::Submission submission = parse(line, record.problem);
+			submissions.push_back(std::move(submission));
+		} catch (const std::exception& e) {
+			record.error = e.what();
+		}
+		records.push_back(std::move(record));
+	}
+
+	size_t size() const { return records.size(); }
+
+	// returns the number of not graded lines
+	size_t flush(std::ostream& out) {
+		std::vector<an::Verification> results = analyzer.check(submissions, options);
+
+		size_t failed = 0;
+		auto result = results.cbegin();
+		std::string json;
+		for (const Record& r: records) {
+			json.clear();
+			if (!r.error.empty()) {
+				json.append("{\"line\": " + std::to_string(r.line) + ", \"error\": ");
+				append_json_string(json, r.error);
+				json.append("}\n");
+				++failed;
+			} else
+				append_result(json, r, *result++);
+			out << json;
+		}
+		out.flush();
+
+		submissions.clear();
+		records.clear();
+		return failed;
+	}
+
+private:
+	// not resized after the construction, the submissions point to the problems
+	std::vector<Problem> oriented;
+	const Options& options;
+	std::multimap<size_t, size_t> by_question;
+
+	an::Analyzer analyzer;
+	std::vector<an::Submission> submissions;
+	std::vector<Record> records;
+
+	an::Submission parse(const std::string& line, size_t& problem_num) {
+		JsonReader reader(line);
+		bool any_problem = false, any_answer = false;
+		std::list<std::string> answer;
+
+		reader.expect('{');
+		if (!reader.consume('}')) {
+			do {
+				std::string key = reader.string();
+				reader.expect(':');
+				if (key == "problem") {
+					long n = reader.number();
+					if (n < 0 || static_cast<size_t>(n) >= oriented.size())
+						throw std::runtime_error("unknown problem");
+					problem_num = static_cast<size_t>(n);
+					any_problem = true;
+				} else if (key == "question") {
+					std::list<std::string> question = prepared(reader.lines());
+					auto range = by_question.equal_range(utils::hash_lines(question));
+					auto it = std::find_if(range.first, range.second,
+						[&](const auto& p) { return oriented[p.second].question() == question; });
+					if (it == range.second)
+						throw std::runtime_error("unknown problem");
+					problem_num = it->second;
+					any_problem = true;
+				} else if (key == "answer") {
+					answer = reader.lines();
+					any_answer = true;
+				} else
+					reader.skip_value();
+			} while (reader.consume(','));
+			reader.expect('}');
+		}
+
+		if (!reader.end())
+			throw std::runtime_error("unexpected symbols after the object");
+		if (!any_problem)
+			throw std::runtime_error("no problem");
+		if (!any_answer)
+			throw std::runtime_error("no answer");
+
+		// invalid utf8 is reported here, the analyzer would throw from a worker
+		for (const std::string& a: answer)
+			if (!utils::is_valid_utf8(a))
+				throw std::runtime_error("invalid utf8 symbol");
+
+		return { &oriented[problem_num], std::move(answer) };
+	}
+
+	void append_result(std::string& json, const Record& r, const an::Verification& v) const {
+		json.append("{\"line\": " + std::to_string(r.line));
+		json.append(", \"problem\": " + std::to_string(r.problem));
+		json.append(", \"state\": " + std::to_string(v.state));
+		json.append(v.right() ? ", \"right\": true" : ", \"right\": false");
+
+		json.append(", \"errors\": [");
+		bool first = true;
+		for (const an::Error& e: v.errors) {
+			json.append(first ? "{\"line\": " : ", {\"line\": ");
+			json.append(std::to_string(e.line));
+			json.append(", \"what\": \"");
+			json.append(error_name(e.what));
+			json.append("\", \"str\": ");
+			append_json_string(json, e.text(v.answer[e.line]));
+			json.append(", \"pos\": " + std::to_string(e.pos) + "}");
+			first = false;
+		}
+		json.append("]");
+
+		if (options.get(Options::ANALYSIS_TOTAL_RECALL) && !v.right()) {
+			json.append(", \"solution\": [");
+			first = true;
+			for (const std::pmr::string& s: v.report) {
+				if (!first) json.append(", ");
+				append_json_string(json, s);
+				first = false;
+			}
+			json.append("]");
+		}
+
+		json.append("}\n");
+	}
+};
+
+} // namespace
+
+size_t grade(const std::vector<std::shared_ptr<Problem>>& problems,
+	const Options& options, std::istream& in, std::ostream& out)
+{
+	Grader grader(problems, options);
+
+	size_t failed = 0, line_num = 0;
+	std::string line;
+	while (std::getline(in, line)) {
+		++line_num;
+		if (std::all_of(line.begin(), line.end(), [](unsigned char c) { return std::isspace(c); }))
+			continue;
+
+		grader.add(line, line_num);
+		if (grader.size() == BATCH_SIZE)
+			failed += grader.flush(out);
+	}
+
+	return failed + grader.flush(out);
+}
+
+} // namespace grading
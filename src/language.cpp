@@ -0,0 +1,343 @@
+/*
+ * language.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#include <algorithm>
+#include <cstdint>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <utils.h>
+
+namespace utils {
+
+namespace {
+
+const int LANGUAGES = static_cast<int>(Language::UK) + 1;
+
+constexpr uint8_t bit(Language l)
+{
+	return static_cast<uint8_t>(1u << static_cast<int>(l));
+}
+
+const uint8_t LATIN = bit(Language::EN) | bit(Language::NL) | bit(Language::DE)
+                    | bit(Language::FR) | bit(Language::ES);
+const uint8_t CYRILLIC = bit(Language::RU) | bit(Language::UK);
+
+// the most frequent words and word endings of the languages, the model keeps their byte trigrams
+struct Profile {
+	Language language;
+	std::string_view words;
+};
+
+constexpr Profile PROFILES[] = {
+	{ Language::EN, "the and of to in is you that it he was for on are with as his they at be this have "
+		"from or one had by but not what all were we when your can said there an each which she do how "
+		"their if will up other about out many then them would like time has two more could people "
+		"ing ed ly tion ness ght th ou where here good morning colour sky am my me just know take year "
+		"into some could them see only come its over think also back after use work first well way" },
+	{ Language::NL, "de het een en van ik te dat die in is niet zijn op aan met voor er maar om hij ze wat "
+		"je was ook als bij of uit nog naar dan kan zo wel al worden heeft mijn goed geen moet hebben "
+		"gaan tijd zich wij jij kunnen zeggen waar hier twee veel naar huis jaar uur kleur lucht dag "
+		"ij oe aa ee uu sch ig lijk tje mij hem haar ons hun zij toen door over heel weer komen zien "
+		"maken doen weten nieuw groot klein" },
+	{ Language::DE, "der die und in den von zu das mit sich des auf für ist im dem nicht ein eine als auch "
+		"es an werden aus er hat dass sie nach wird bei einer um am sind noch wie einem über einen so "
+		"zum war haben nur oder aber vor zur bis mehr durch man ich möchte können wo guten morgen tag "
+		"ein zwei farbe himmel ung sch cht ig lich keit heit en mein dein kein wir ihr uns euch jetzt "
+		"schon immer viel gut gehen kommen machen sagen sehen wissen neu groß klein danke bitte" },
+	{ Language::FR, "le de un à être et en avoir que pour dans ce il qui ne sur se pas plus pouvoir par je "
+		"avec tout faire son mettre autre on mais nous comme ou si leur dire elle devant deux même prendre "
+		"aussi celui donner bien où fois vous est les des une du au cette bonjour jour ciel couleur gare "
+		"eau eux oir ait ent tion ique suis sont mon ton mes tes notre votre très beaucoup merci "
+		"aller venir voir savoir petit grand nouveau chez quand" },
+	{ Language::ES, "el la de que y a en un ser se no haber por con su para como estar tener le lo todo "
+		"pero más hacer o poder decir este ir otro ese si me ya ver porque dar cuando él muy sin vez "
+		"mucho saber qué sobre mi mismo yo también hasta año dos querer entre así los las del una "
+		"buenos días dónde está cielo ción dad mente ado ido os as estoy tengo hay hoy bueno malo "
+		"gracias noche grande pequeño nuevo vivir hermano casa ahora siempre" },
+	{ Language::RU, "и в не на я быть он с что а по это она этот к но они мы как из у который то за свой "
+		"весь год от так о для ты же все тот мочь вы человек такой его сказать только или ещё бы себя "
+		"один уже до время если сам когда другой вот говорить наш мой знать стать при чтобы дело жизнь "
+		"кто первый очень день её новый рука даже раз где там под можно после их работа без самый потом "
+		"надо хотеть ли слово идти большой должен место иметь доброе утро цвет где "
+		"ое ый ая ого ому ешь ться ство ение ал ла ли спасибо хорошо сегодня сейчас здесь тоже "
+		"нет да есть всё мне тебе меня тебя" },
+	{ Language::UK, "і в не на я бути він з що а по це вона цей до але вони ми як із у який то за свій "
+		"весь рік від так про для ти же все той могти ви людина такий його сказати тільки або ще би себе "
+		"один вже час якщо сам коли інший ось говорити наш мій знати стати при щоб справа життя хто "
+		"перший дуже день її новий рука навіть раз де там під можна після їх робота без самий потім "
+		"треба хотіти слово йти великий повинен місце мати добрий ранок колір "
+		"ий ого ому ння ться ство ення ати ити ав ла ли дякую добре сьогодні зараз тут також "
+		"ні так є все мені тобі мене тебе" },
+};
+
+// letters, which are used by some of the languages only
+struct Letters {
+	uint8_t languages;
+	std::u32string_view letters;
+};
+
+constexpr Letters LETTERS[] = {
+	{ bit(Language::DE), U"ßäöü" },
+	{ bit(Language::FR), U"éèêàçœâîôûù" },
+	{ bit(Language::FR) | bit(Language::NL), U"ëï" },
+	{ bit(Language::ES), U"ñáíóú¿¡" },
+	{ bit(Language::RU), U"ыэъё" },
+	{ bit(Language::UK), U"іїєґ" },
+};
+
+// trigrams are three bytes of the text: downcased letters, a space instead of anything else
+constexpr uint32_t push_byte(uint32_t trigram, uint8_t byte)
+{
+	return ((trigram << 8) | byte) & 0xFFFFFF;
+}
+
+// a trigram over a word boundary is not a feature
+constexpr bool inside_word(uint32_t trigram)
+{
+	return ((trigram >> 8) & 0xFF) != ' ';
+}
+
+// trigram -> bit mask of languages, open addressing
+class TrigramModel
+{
+	static const int BITS = 14;
+	static const size_t SIZE = size_t(1) << BITS; // about a quarter is filled
+	uint32_t trigrams[SIZE];
+	uint8_t languages[SIZE];
+
+	constexpr size_t slot(uint32_t trigram) const {
+		size_t i = static_cast<uint32_t>(trigram * 2654435761u) >> (32 - BITS);
+		while (trigrams[i] != 0 && trigrams[i] != trigram)
+			i = (i + 1) % SIZE;
+		return i;
+	}
+
+public:
+	constexpr TrigramModel() : trigrams(), languages() {
+		for (const Profile& p: PROFILES) {
+			uint32_t trigram = ' ';
+			for (size_t i = 0; i <= p.words.size(); ++i) {
+				uint8_t byte = i < p.words.size() ? static_cast<uint8_t>(p.words[i]) : ' ';
+				trigram = push_byte(trigram, byte);
+				if (trigram > 0xFFFF && inside_word(trigram)) {
+					size_t s = slot(trigram);
+					trigrams[s] = trigram;
+					languages[s] |= bit(p.language);
+				}
+			}
+		}
+	}
+
+	uint8_t operator[](uint32_t trigram) const { return languages[slot(trigram)]; }
+};
+
+// the letters of the scripts are in the two octets range of utf8
+class LetterTable
+{
+	static const char32_t SIZE = 0x500;
+	uint8_t languages[SIZE];
+
+public:
+	constexpr LetterTable() : languages() {
+		for (const Letters& l: LETTERS)
+			for (char32_t c: l.letters)
+				languages[c] = l.languages;
+	}
+
+	uint8_t operator[](char32_t c) const { return c < SIZE ? languages[c] : 0; }
+};
+
+// a trigram of fewer languages tells more, by the number of languages having it;
+// the languages of a trigram or a letter are always of the same script
+constexpr int TRIGRAM_WEIGHTS[LANGUAGES + 1] = { 0, 6, 3, 2, 1, 1, 1, 1, 1 };
+// a specific letter weighs as much as several trigrams
+const int LETTER_WEIGHT = 12;
+
+// scores of a bit mask of languages, 16 bits per language: languages 0-3 in 'low', 4-7 in 'high'
+struct PackedScores {
+	uint64_t low = 0, high = 0;
+};
+
+class ScoreTable
+{
+	PackedScores scores[256];
+
+public:
+	constexpr ScoreTable(bool by_specificity) : scores() {
+		for (int mask = 1; mask < 256; ++mask) {
+			int languages = 0;
+			for (int l = 0; l < LANGUAGES; ++l)
+				languages += (mask >> l) & 1;
+
+			uint64_t weight = by_specificity ? TRIGRAM_WEIGHTS[languages] : LETTER_WEIGHT;
+			for (int l = 0; l < LANGUAGES; ++l)
+				if (mask & (1 << l))
+					(l < 4 ? scores[mask].low : scores[mask].high) |= weight << (16 * (l % 4));
+		}
+	}
+
+	const PackedScores& operator[](uint8_t mask) const { return scores[mask]; }
+};
+
+constexpr TrigramModel TRIGRAMS;
+constexpr LetterTable SPECIFIC_LETTERS;
+constexpr ScoreTable TRIGRAM_SCORES(true);
+constexpr ScoreTable LETTER_SCORES(false);
+
+// packed scores are added up to the limit of 16 bits
+const size_t SPILL_PERIOD = 65535 / LETTER_WEIGHT;
+// the beginning of a long text is enough for the model
+const size_t MAX_SAMPLE = 2048;
+
+bool is_letter(char32_t c)
+{
+	return (c >= 0xC0 && c <= 0x24F && c != 0xD7 && c != 0xF7) // Latin-1 and Extended-A, B
+	    || (c >= 0x400 && c <= 0x4FF);                          // Cyrillic
+}
+
+// ASCII letters and lead bytes of Cyrillic (0xD0 - 0xD3), 16 bytes at a time
+void count_scripts(const uint8_t* s, size_t n, size_t& latin, size_t& cyrillic)
+{
+	size_t i = 0;
+#ifdef __SSE2__
+	const __m128i case_bit = _mm_set1_epi8(0x20);
+	const __m128i a = _mm_set1_epi8('a' - 1), z = _mm_set1_epi8('z' + 1);
+	// lead bytes are negative as signed chars
+	const __m128i cyrillic_first = _mm_set1_epi8(static_cast<char>(0xD0 - 1));
+	const __m128i cyrillic_last = _mm_set1_epi8(static_cast<char>(0xD3 + 1));
+	for (; i + 16 <= n; i += 16) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+		__m128i lower = _mm_or_si128(chunk, case_bit);
+		__m128i letters = _mm_and_si128(_mm_cmpgt_epi8(lower, a), _mm_cmplt_epi8(lower, z));
+		__m128i leads = _mm_and_si128(_mm_cmpgt_epi8(chunk, cyrillic_first), _mm_cmplt_epi8(chunk, cyrillic_last));
+		latin += __builtin_popcount(_mm_movemask_epi8(letters));
+		cyrillic += __builtin_popcount(_mm_movemask_epi8(leads));
+	}
+#endif
+	for (; i < n; ++i) {
+		uint8_t lower = s[i] | 0x20;
+		latin += lower >= 'a' && lower <= 'z';
+		cyrillic += s[i] >= 0xD0 && s[i] <= 0xD3;
+	}
+}
+
+} // namespace
+
+const char* language_code(Language language)
+{
+	switch (language) {
+	case Language::EN: return "en";
+	case Language::RU: return "ru";
+	case Language::NL: return "nl";
+	case Language::DE: return "de";
+	case Language::FR: return "fr";
+	case Language::ES: return "es";
+	case Language::UK: return "uk";
+	case Language::UNKNOWN: break;
+	}
+	return "";
+}
+
+Language language_by_code(std::string_view code)
+{
+	for (int l = 1; l < LANGUAGES; ++l)
+		if (code == language_code(static_cast<Language>(l)))
+			return static_cast<Language>(l);
+	return Language::UNKNOWN;
+}
+
+Language what_language(std::string_view s)
+{
+	if (!is_valid_utf8(s))
+		return Language::UNKNOWN;
+
+	// the script chooses the candidates, latin letters of a cyrillic text are not counted as cyrillic
+	size_t latin = 0, cyrillic = 0;
+	count_scripts(reinterpret_cast<const uint8_t*>(s.data()), s.size(), latin, cyrillic);
+	if (latin == 0 && cyrillic == 0)
+		return Language::UNKNOWN;
+	uint8_t candidates = cyrillic > latin ? CYRILLIC : LATIN;
+
+	size_t scores[LANGUAGES] = {};
+	uint64_t low = 0, high = 0;
+	size_t added = 0;
+	auto spill = [&]() {
+		for (int l = 0; l < 4; ++l) {
+			scores[l] += (low >> (16 * l)) & 0xFFFF;
+			scores[l + 4] += (high >> (16 * l)) & 0xFFFF;
+		}
+		low = high = 0;
+		added = 0;
+	};
+	auto add = [&](const PackedScores& p) {
+		low += p.low;
+		high += p.high;
+		if (++added == SPILL_PERIOD)
+			spill();
+	};
+
+	uint32_t trigram = ' ';
+	auto push = [&trigram, &add](uint8_t byte) {
+		// a run of non-letters is one space
+		if (byte == ' ' && (trigram & 0xFF) == ' ')
+			return;
+		trigram = push_byte(trigram, byte);
+		if (trigram > 0xFFFF && inside_word(trigram))
+			add(TRIGRAM_SCORES[TRIGRAMS[trigram]]);
+	};
+
+	// the sample ends at a code point boundary
+	size_t sample = std::min(s.size(), MAX_SAMPLE);
+	while (sample < s.size() && (static_cast<uint8_t>(s[sample]) & 0xC0) == 0x80)
+		++sample;
+
+	size_t i = 0;
+	while (i < sample) {
+		uint8_t byte = static_cast<uint8_t>(s[i]);
+		if (byte < 0x80) {
+			uint8_t lower = byte | 0x20;
+			push(lower >= 'a' && lower <= 'z' ? lower : ' ');
+			++i;
+			continue;
+		}
+
+		// the letters of the scripts are two octets, the text is valid
+		char32_t c;
+		if (byte < 0xE0) {
+			c = ((byte & 0x1F) << 6) | (static_cast<uint8_t>(s[i + 1]) & 0x3F);
+			i += 2;
+		} else
+			c = next_code_point(s, i);
+
+		c = fold_case(c);
+		if (!is_letter(c)) {
+			push(' ');
+			continue;
+		}
+
+		// the letters are two octets in utf8
+		add(LETTER_SCORES[SPECIFIC_LETTERS[c]]);
+		push(static_cast<uint8_t>((c >> 6) | 0xC0));
+		push(static_cast<uint8_t>((c & 0x3F) | 0x80));
+	}
+	push(' ');
+	spill();
+
+	// without any evidence a latin text is english and a cyrillic one is russian
+	Language result = cyrillic > latin ? Language::RU : Language::EN;
+	for (int l = 1; l < LANGUAGES; ++l)
+		if ((bit(static_cast<Language>(l)) & candidates) && scores[l] > scores[static_cast<int>(result)])
+			result = static_cast<Language>(l);
+	return result;
+}
+
+} // namespace utils
@@ -0,0 +1,171 @@
+/*
+ * latency.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#include <csignal>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <latency.h>
+#include <log.h>
+
+namespace latency {
+
+namespace detail {
+bool on = false;
+} // namespace detail
+
+namespace {
+
+std::string output;
+std::array<Histogram, static_cast<size_t>(Event::COUNT)> histograms;
+volatile std::sig_atomic_t dump_signal = 0;
+
+void on_dump_signal(int)
+{
+	dump_signal = 1;
+}
+
+std::string microseconds(std::chrono::nanoseconds ns)
+{
+	std::ostringstream os;
+	os << std::fixed << std::setprecision(1) << ns.count() / 1000.0 << " us";
+	return os.str();
+}
+
+} // namespace
+
+const char* event_name(Event event)
+{
+	switch (event) {
+	case Event::KEY: return "key";
+	case Event::SUBMIT: return "submit";
+	case Event::TRANSITION: return "transition";
+	case Event::COUNT: break;
+	}
+	return "";
+}
+
+int Histogram::bucket(uint64_t ns)
+{
+	if (ns < SUB_BUCKETS)
+		return static_cast<int>(ns);
+	// the highest bit is the power, the next 3 bits are the sub-bucket
+	int power = 63 - __builtin_clzll(ns);
+	int sub = static_cast<int>(ns >> (power - 3)) & (SUB_BUCKETS - 1);
+	return (power - 2) * SUB_BUCKETS + sub;
+}
+
+uint64_t Histogram::lower_bound(int bucket)
+{
+	if (bucket < SUB_BUCKETS)
+		return static_cast<uint64_t>(bucket);
+	int power = bucket / SUB_BUCKETS + 2;
+	uint64_t sub = static_cast<uint64_t>(bucket % SUB_BUCKETS);
+	return (SUB_BUCKETS + sub) << (power - 3);
+}
+
+void Histogram::record(std::chrono::nanoseconds value)
+{
+	uint64_t ns = value.count() > 0 ? static_cast<uint64_t>(value.count()) : 0;
+	++counts[bucket(ns)];
+	++total;
+	sum += ns;
+	if (ns > maximum)
+		maximum = ns;
+}
+
+std::chrono::nanoseconds Histogram::mean() const
+{
+	return std::chrono::nanoseconds(total == 0 ? 0 : sum / total);
+}
+
+std::chrono::nanoseconds Histogram::percentile(double p) const
+{
+	if (total == 0)
+		return std::chrono::nanoseconds(0);
+
+	uint64_t rank = static_cast<uint64_t>(p * (total - 1));
+	uint64_t seen = 0;
+	for (int b = 0; b < BUCKETS; ++b) {
+		seen += counts[b];
+		if (seen > rank)
+			return std::chrono::nanoseconds(lower_bound(b));
+	}
+	return max();
+}
+
+void Histogram::write(std::ostream& os, const std::string& name) const
+{
+	os << name << ": " << total << " events";
+	if (total == 0) {
+		os << std::endl;
+		return;
+	}
+	os << ", mean " << microseconds(mean())
+		<< ", p50 " << microseconds(percentile(0.5))
+		<< ", p90 " << microseconds(percentile(0.9))
+		<< ", p99 " << microseconds(percentile(0.99))
+		<< ", max " << microseconds(max()) << std::endl;
+
+	for (int b = 0; b < BUCKETS; ++b)
+		if (counts[b] != 0)
+			os << "  >= " << std::setw(12) << microseconds(std::chrono::nanoseconds(lower_bound(b)))
+				<< ": " << counts[b] << std::endl;
+}
+
+void enable(const std::string& filename)
+{
+	output = filename;
+	detail::on = true;
+
+	struct sigaction action = {};
+	action.sa_handler = on_dump_signal;
+	sigemptyset(&action.sa_mask);
+	// no SA_RESTART, the wait of the input is interrupted to dump at once
+	sigaction(SIGUSR1, &action, nullptr);
+}
+
+void record(Event event, Clock::time_point start)
+{
+	histograms[static_cast<size_t>(event)].record(Clock::now() - start);
+}
+
+const Histogram& histogram(Event event)
+{
+	return histograms[static_cast<size_t>(event)];
+}
+
+bool dump_requested()
+{
+	if (!dump_signal)
+		return false;
+	dump_signal = 0;
+	return true;
+}
+
+void dump()
+{
+	if (!enabled())
+		return;
+
+	std::ofstream file(output, std::ios::app);
+	if (!file) {
+		logging::Error() << "can't write the latencies to " << output << logging::endl;
+		return;
+	}
+
+	std::time_t now = std::time(nullptr);
+	file << "# " << std::put_time(std::localtime(&now), "%F %T") << std::endl;
+	for (size_t e = 0; e < histograms.size(); ++e)
+		histograms[e].write(file, event_name(static_cast<Event>(e)));
+}
+
+} // namespace latency
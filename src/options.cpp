@@ -3,32 +3,33 @@
 
 #include <list>
 #include <map>
+#include <stdexcept>
 
 using namespace cmd;
 
 std::map<char, Options::Flags> Options::args_lookup_table =
 {
+	{ 'a', Flags::LIVE_CHECK },
 	{ 'c', Flags::ANALYSIS_CASE_UNSENSITIVE },
 	{ 'e', Flags::ACCEPT_BY_ENTER },
+	{ 'f', Flags::ANALYSIS_FUZZY },
+	{ 'g', Flags::GRADE },
 	{ 'h', Flags::SHOW_CMD_HELP },
 	{ 'i', Flags::QS_INVERTED },
 	{ 'l', Flags::AUTO_LANGUAGE },
 	{ 'm', Flags::QS_MIXED },
+	{ 'o', Flags::TIME_LIMIT },
 	{ 'p', Flags::PLAY_SOLUTION },
 	{ 'r', Flags::REPEAT_ERRORS_ONLY },
 	{ 'q', Flags::HIDE_QUESTION },
 	{ 's', Flags::SHOW_STATISTICS },
 	{ 't', Flags::USE_TOPICS },
 	{ 'u', Flags::ANALYSIS_PUNTCTUATION_UNSENSITIVE },
+	{ 'v', Flags::PRERENDER },
 	{ 'w', Flags::READ_QUESTION },
 	{ 'z', Flags::ANALYSIS_TOTAL_RECALL }
 };
 
-bool Options::get(Flags flag) const
-{
-	return _args.find(flag) != _args.end();
-}
-
 std::list<std::string> Options::args(Flags flag) const
 {
 	if (!get(flag))
@@ -74,6 +75,7 @@ bool Options::parse_arguments(int argc, char* argv[])
 
 				last_option_flag = flag_it->second;
 				_args.insert({ last_option_flag, std::list<std::string>() });
+				_flags |= 1u << last_option_flag;
 			}
 			continue;
 		}
@@ -86,5 +88,45 @@ bool Options::parse_arguments(int argc, char* argv[])
 		_args.at(last_option_flag).push_back(arg);
 	}
 
+	if (get(Flags::ANALYSIS_FUZZY) && !_args.at(Flags::ANALYSIS_FUZZY).empty()) {
+		double threshold = 0;
+		try {
+			threshold = std::stod(_args.at(Flags::ANALYSIS_FUZZY).front());
+		} catch (const std::exception&) {}
+
+		if (threshold <= 0 || threshold >= 1) {
+			logging::Error() << "fuzzy threshold has to be between 0 and 1" << logging::endl;
+			return false;
+		}
+		_fuzzy_threshold = threshold;
+	}
+
+	if (get(Flags::PRERENDER) && !_args.at(Flags::PRERENDER).empty()) {
+		int threads = 0;
+		try {
+			threads = std::stoi(_args.at(Flags::PRERENDER).front());
+		} catch (const std::exception&) {}
+
+		if (threads <= 0) {
+			logging::Error() << "number of prerender workers has to be positive" << logging::endl;
+			return false;
+		}
+		_prerender_threads = static_cast<unsigned>(threads);
+	}
+
+	if (get(Flags::TIME_LIMIT)) {
+		int seconds = 0;
+		try {
+			if (!_args.at(Flags::TIME_LIMIT).empty())
+				seconds = std::stoi(_args.at(Flags::TIME_LIMIT).front());
+		} catch (const std::exception&) {}
+
+		if (seconds <= 0) {
+			logging::Error() << "time limit has to be a positive number of seconds" << logging::endl;
+			return false;
+		}
+		_time_limit = seconds;
+	}
+
 	return true;
 }
@@ -218,26 +218,16 @@ std::vector<std::shared_ptr<Problem>> Parser::load(const Options& options)
 		if (t != LINE_NO_TYPE) trim_type(line);
 		utils::trim_spaces(line);
 		utils::remove_duplicate_spaces(line);
+		utils::normalize(line);
 
 		if (t == LINE_TOPIC) {
 			topics_in_quiz.insert(line);
 			needed_topic = options.get(Options::USE_TOPICS) && topics.find(line) != topics.end();
 			continue;
 		} else if (t == LINE_LANGUAGE) {
-			auto detectLanguage = [](const std::string& s) {
-				if (s == "ru")
-					return utils::Language::RU;
-				if (s == "en")
-					return utils::Language::EN;
-				if (s == "nl")
-					return utils::Language::NL;
-
-				return utils::Language::UNKNOWN;
-			};
-
 			auto langs = utils::split(line, " ");
-			question_language = detectLanguage(langs[0]);
-			solution_language = detectLanguage(langs[1]);
+			question_language = utils::language_by_code(langs[0]);
+			solution_language = utils::language_by_code(langs[1]);
 			continue;
 		} else if (t == LINE_SOLUTION) {
 			state = STATE_SOLUTION_PREPARING;
@@ -267,7 +257,8 @@ std::vector<std::shared_ptr<Problem>> Parser::load(const Options& options)
 		if (state_changed && prev_state == STATE_SOLUTION_PREPARING) {
 			if (quest.size() > 0 && solut.size() > 0) {
 				++question_number;
-				problems.push_back(std::make_shared<Problem>(quest, solut, question_language, solution_language));
+				problems.push_back(std::make_shared<Problem>(std::move(quest), std::move(solut),
+					question_language, solution_language));
 				questions_loaded++;
 
 				quest.clear();
@@ -291,7 +282,8 @@ std::vector<std::shared_ptr<Problem>> Parser::load(const Options& options)
 	}
 
 	if (quest.size() > 0 && solut.size() > 0) {
-		problems.push_back(std::make_shared<Problem>(quest, solut, question_language, solution_language));
+		problems.push_back(std::make_shared<Problem>(std::move(quest), std::move(solut),
+			question_language, solution_language));
 	}
 
 	quiz_ifstream.close();
@@ -0,0 +1,300 @@
+/*
+ * pattern.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+
+#include <pattern.h>
+#include <utils.h>
+
+namespace analysis {
+
+namespace {
+
+const char GROUP_BEGIN = '{';
+const char GROUP_END   = '}';
+const char ALTERNATIVE = '|';
+
+// every segment is a list of alternatives, literal text has the only one
+std::vector<std::vector<std::string>> split_to_segments(const std::string& line)
+{
+	std::vector<std::vector<std::string>> segments;
+	std::string literal;
+
+	size_t pos = 0;
+	while (pos < line.size()) {
+		size_t begin = line.find(GROUP_BEGIN, pos);
+		size_t end = begin != std::string::npos ? line.find(GROUP_END, begin) : std::string::npos;
+		if (end == std::string::npos) {
+			literal.append(line, pos, std::string::npos);
+			break;
+		}
+
+		std::string group = line.substr(begin + 1, end - begin - 1);
+		if (group.find(ALTERNATIVE) == std::string::npos) {
+			literal.append(line, pos, end + 1 - pos);
+			pos = end + 1;
+			continue;
+		}
+
+		literal.append(line, pos, begin - pos);
+		segments.push_back({ literal });
+		literal.clear();
+
+		// empty alternatives are kept, "{the|}" is an optional "the"
+		std::vector<std::string> alternatives;
+		size_t alt_begin = 0, alt_end;
+		while ((alt_end = group.find(ALTERNATIVE, alt_begin)) != std::string::npos) {
+			alternatives.push_back(group.substr(alt_begin, alt_end - alt_begin));
+			alt_begin = alt_end + 1;
+		}
+		alternatives.push_back(group.substr(alt_begin));
+		segments.push_back(alternatives);
+
+		pos = end + 1;
+	}
+
+	segments.push_back({ literal });
+	return segments;
+}
+
+// nondeterministic automaton, the states are numbered in order of alternatives
+struct Nfa
+{
+	struct State {
+		std::vector<std::pair<std::string, size_t>> edges;
+		std::vector<size_t> epsilons;
+	};
+
+	std::vector<State> states = std::vector<State>(1);
+
+	size_t add_state() {
+		states.emplace_back();
+		return states.size() - 1;
+	}
+
+	size_t add_tokens(size_t from, const Tokens& tokens) {
+		for (const Token& t: tokens) {
+			size_t to = add_state();
+			states[from].edges.push_back({ std::string(t.str), to });
+			from = to;
+		}
+		return from;
+	}
+
+	std::vector<size_t> closure(std::vector<size_t> set) const {
+		for (size_t i = 0; i < set.size(); ++i)
+			for (size_t e: states[set[i]].epsilons)
+				if (std::find(set.begin(), set.end(), e) == set.end())
+					set.push_back(e);
+
+		std::sort(set.begin(), set.end());
+		return set;
+	}
+};
+
+} // namespace
+
+Pattern::Pattern(const std::string& line, int options)
+{
+	Nfa nfa;
+	size_t last = 0;
+	std::pmr::string folded;
+	for (const std::vector<std::string>& segment: split_to_segments(line)) {
+		if (segment.size() == 1) {
+			last = nfa.add_tokens(last, Analyzer::tokens(segment.front(), options, folded));
+			continue;
+		}
+
+		size_t exit = nfa.add_state();
+		for (const std::string& alternative: segment) {
+			size_t alt_last = nfa.add_tokens(last, Analyzer::tokens(alternative, options, folded));
+			nfa.states[alt_last].epsilons.push_back(exit);
+		}
+		last = exit;
+	}
+
+	// subset construction
+	std::map<std::vector<size_t>, size_t> dfa_ids;
+	std::vector<std::vector<size_t>> subsets = { nfa.closure({ 0 }) };
+	dfa_ids.insert({ subsets.front(), 0 });
+
+	for (size_t i = 0; i < subsets.size(); ++i) {
+		State state;
+		std::vector<std::pair<std::string, std::vector<size_t>>> moves;
+		for (size_t s: subsets[i]) {
+			state.accepting |= s == last;
+			for (const auto& edge: nfa.states[s].edges) {
+				auto move = std::find_if(moves.begin(), moves.end(),
+					[&edge](const auto& m) { return m.first == edge.first; });
+				if (move == moves.end())
+					moves.push_back({ edge.first, { edge.second } });
+				else
+					move->second.push_back(edge.second);
+			}
+		}
+
+		for (auto& move: moves) {
+			std::vector<size_t> subset = nfa.closure(move.second);
+			auto id = dfa_ids.insert({ subset, subsets.size() });
+			if (id.second)
+				subsets.push_back(subset);
+			state.edges.push_back({ move.first, id.first->second });
+		}
+
+		states.push_back(std::move(state));
+	}
+
+	for (State& s: states)
+		for (const auto& edge: s.edges)
+			s.next.emplace(edge.first, edge.second);
+
+	// the automaton is acyclic, distances settle after a pass per state at most
+	std::vector<size_t> distance(states.size(), NONE);
+	for (size_t i = 0; i < states.size(); ++i)
+		if (states[i].accepting) distance[i] = 0;
+
+	for (bool changed = true; changed; ) {
+		changed = false;
+		for (size_t i = 0; i < states.size(); ++i)
+			for (size_t e = 0; e < states[i].edges.size(); ++e) {
+				size_t to = distance[states[i].edges[e].second];
+				if (to != NONE && to + 1 < distance[i] && !states[i].accepting) {
+					distance[i] = to + 1;
+					states[i].witness = e;
+					changed = true;
+				}
+			}
+	}
+}
+
+size_t Pattern::step(size_t state, std::string_view token) const
+{
+	auto it = states[state].next.find(token);
+	return it != states[state].next.end() ? it->second : NONE;
+}
+
+bool Pattern::match(const Tokens& answer) const
+{
+	size_t state = 0;
+	for (const Token& t: answer)
+		if ((state = step(state, t.str)) == NONE)
+			return false;
+
+	return states[state].accepting;
+}
+
+Tokens Pattern::closest(const Tokens& answer) const
+{
+	Tokens result(answer.get_allocator());
+	auto push_witness = [this, &result](size_t& state) {
+		const auto& edge = states[state].edges[states[state].witness];
+		result.push_back({ Token::WORD, edge.first, 0 });
+		state = edge.second;
+	};
+
+	size_t state = 0;
+	auto token = answer.cbegin();
+	while (token != answer.cend()) {
+		size_t next = step(state, token->str);
+		if (next != NONE) { // right token
+			result.push_back({ Token::WORD, token->str, 0 });
+			state = next;
+			++token;
+			continue;
+		}
+
+		// accepting state, the rest of the answer is redundant
+		if (states[state].witness == NONE)
+			break;
+
+		// token missed in answer, the current one follows the witness
+		size_t witness_next = states[state].edges[states[state].witness].second;
+		if (step(witness_next, token->str) != NONE) {
+			push_witness(state);
+			continue;
+		}
+
+		// redundant token in answer, the pattern continues with the next one
+		auto token_next = std::next(token);
+		if (token_next != answer.cend() && step(state, token_next->str) != NONE) {
+			++token;
+			continue;
+		}
+
+		// error token, the alternative with most of symbols on their places is the closest
+		const auto& edge = states[state].edges[closest_edge(state, token->str)];
+		result.push_back({ Token::WORD, edge.first, 0 });
+		state = edge.second;
+		++token;
+	}
+
+	while (!states[state].accepting)
+		push_witness(state);
+
+	return result;
+}
+
+size_t Pattern::closest_edge(size_t state, std::string_view token) const
+{
+	int token_length = static_cast<int>(utils::utf8_length(token));
+	auto similarity = [token, token_length](std::string_view str) {
+		int result = -std::abs(static_cast<int>(utils::utf8_length(str)) - token_length);
+		for (size_t s = 0, t = 0; s < str.size() && t < token.size(); )
+			result += utils::next_code_point(str, s) == utils::next_code_point(token, t);
+		return result;
+	};
+
+	const State& current = states[state];
+	size_t closest = current.witness;
+	int closest_similarity = similarity(current.edges[closest].first);
+	for (size_t e = 0; e < current.edges.size(); ++e) {
+		int edge_similarity = similarity(current.edges[e].first);
+		if (edge_similarity > closest_similarity) {
+			closest = e;
+			closest_similarity = edge_similarity;
+		}
+	}
+
+	return closest;
+}
+
+size_t Pattern::advance(size_t state, std::string_view token, bool& right) const
+{
+	size_t next = step(state, token);
+	right = next != NONE;
+	if (right)
+		return next;
+
+	// accepting state, the token is redundant
+	if (states[state].witness == NONE)
+		return state;
+
+	return states[state].edges[closest_edge(state, token)].second;
+}
+
+bool Pattern::continues(size_t state, std::string_view prefix) const
+{
+	for (const auto& edge: states[state].edges)
+		if (edge.first.compare(0, prefix.size(), prefix) == 0)
+			return true;
+	return false;
+}
+
+std::string Pattern::plain(const std::string& line)
+{
+	std::string result;
+	for (const std::vector<std::string>& segment: split_to_segments(line))
+		result.append(segment.front());
+
+	return result;
+}
+
+} // namespace analysis
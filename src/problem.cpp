@@ -4,10 +4,20 @@
 
 const std::list<std::string>& Problem::question() const
 {
-	return !inverted ? _question : _solution;
+	return !inverted ? _question->list : _solution->list;
 }
 
 const std::list<std::string>& Problem::solution() const
+{
+	return !inverted ? _solution->list : _question->list;
+}
+
+SharedLines Problem::shared_question() const
+{
+	return !inverted ? _question : _solution;
+}
+
+SharedLines Problem::shared_solution() const
 {
 	return !inverted ? _solution : _question;
 }
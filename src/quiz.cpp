@@ -50,7 +50,7 @@ Verification Quiz::apply_answer(const std::list<std::string>& answer) {
 
 	Verification result = _analyzer.check(*problem, answer, _options);
 
-	if (result.state == analysis::MARK::RIGHT) {
+	if (result.right()) {
 		problem->repeat--;
 		if (problem->repeat == 0) {
 			_solved_count++;
@@ -0,0 +1,162 @@
+/*
+ * recognizer.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <pocketsphinx/pocketsphinx.h>
+#include <sphinxbase/ad.h>
+#include <sphinxbase/err.h>
+#include <sphinxbase/cmd_ln.h>
+
+#include <recognizer.h>
+
+namespace audio {
+
+namespace {
+
+const char *hmm_verbose = "/usr/share/sphinx-voxforge-en/hmm/voxforge_en_sphinx.cd_cont_3000";
+const char *lm_verbose = "/usr/share/sphinx-voxforge-en/lm/voxforge_en_sphinx.cd_cont_3000/voxforge_en_sphinx.lm.DMP";
+const char *dict_verbose = "/usr/share/sphinx-voxforge-en/lm/voxforge_en_sphinx.cd_cont_3000/voxforge_en_sphinx.dic";
+
+//const char *hmm_default = "/usr/share/pocketsphinx/model/hmm/en_US/hub4wsj_sc_8k";
+//const char *lm_default = "/usr/share/pocketsphinx/model/lm/en_US/hub4.5000.DMP";
+//const char *dict_default = "/usr/share/pocketsphinx/model/lm/en_US/cmu07a.dic";
+
+// 1/16 s at 16 kHz, the partial hypotheses are updated by a block
+const size_t BLOCK_SIZE = 1024;
+
+// a recording device gives the samples continuously, the silence too
+const std::chrono::seconds DEVICE_TIMEOUT(1);
+
+} // namespace
+
+Microphone::Microphone(int sample_rate)
+	: ad(ad_open_dev(NULL, sample_rate))
+	, rate(sample_rate)
+{
+	if (!ad)
+		throw std::runtime_error("Microphone: can't open the audio device");
+}
+
+Microphone::~Microphone()
+{
+	ad_close(ad);
+}
+
+void Microphone::start()
+{
+	ad_start_rec(ad);
+}
+
+void Microphone::stop()
+{
+	ad_stop_rec(ad);
+}
+
+size_t Microphone::read(int16_t* samples, size_t max)
+{
+	// ad_read doesn't block, the device is polled
+	auto deadline = std::chrono::steady_clock::now() + DEVICE_TIMEOUT;
+	for (;;) {
+		int32 n = ad_read(ad, samples, static_cast<int32>(max));
+		if (n < 0)
+			return 0;
+		if (n > 0)
+			return static_cast<size_t>(n);
+		if (std::chrono::steady_clock::now() > deadline)
+			throw std::runtime_error("Microphone: no audio from the device");
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+}
+
+Recognizer::Recognizer()
+{
+	config = cmd_ln_init(NULL, ps_args(), TRUE, // the default values are passed by ps_args()
+		"-hmm", hmm_verbose,   // path to the standard english language model
+		"-lm", lm_verbose,     // custom language model (file must be present)
+		"-dict", dict_verbose, // custom dictionary (file must be present)
+		"-logfn", "/dev/null", // suppress log info from being sent to screen
+		NULL);
+	if (!config)
+		throw std::runtime_error("Recognizer: can't create the config");
+
+	ps = ps_init(config);
+	if (!ps) {
+		cmd_ln_free_r(config);
+		throw std::runtime_error("Recognizer: can't load the models");
+	}
+}
+
+Recognizer::~Recognizer()
+{
+	ps_free(ps);
+	cmd_ln_free_r(config);
+}
+
+int Recognizer::sample_rate() const
+{
+	return static_cast<int>(cmd_ln_float32_r(config, "-samprate"));
+}
+
+std::string Recognizer::recognize(Source& source, const Hypothesis& hypothesis, const Stop& stop)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::vector<int16_t> block(BLOCK_SIZE);
+	VoiceGate gate(source.sample_rate());
+	bool speech_started = false;
+	std::string partial;
+
+	source.start();
+	ps_start_utt(ps);
+
+	// a failed device leaves the decoder ready for the next utterance
+	try {
+		size_t n;
+		while (!(stop && stop()) && (n = source.read(block.data(), block.size())) > 0) {
+			const std::vector<int16_t>& voice = gate.feed(block.data(), n);
+			if (voice.empty())
+				continue;
+
+			ps_process_raw(ps, voice.data(), voice.size(), FALSE, FALSE);
+
+			char const *hyp = ps_get_hyp(ps, NULL);
+			if (hyp && partial != hyp) {
+				partial = hyp;
+				if (hypothesis)
+					hypothesis(partial, false);
+			}
+
+			// the end of the speech is detected by the decoder
+			bool in_speech = ps_get_in_speech(ps);
+			if (in_speech)
+				speech_started = true;
+			else if (speech_started)
+				break;
+		}
+	} catch (...) {
+		ps_end_utt(ps);
+		source.stop();
+		throw;
+	}
+
+	ps_end_utt(ps);
+	source.stop();
+
+	char const *hyp = ps_get_hyp(ps, NULL);
+	std::string result = hyp ? hyp : "";
+	if (hypothesis)
+		hypothesis(result, true);
+	return result;
+}
+
+} // namespace audio
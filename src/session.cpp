@@ -0,0 +1,433 @@
+/*
+ * session.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <memory_resource>
+#include <random>
+#include <sstream>
+
+#include <analyzer.h>
+#include <log.h>
+#include <parser.h>
+#include <pattern.h>
+#include <session.h>
+
+namespace session {
+
+namespace {
+
+namespace an = analysis;
+
+const int REPEAT_TIMES = 2;
+
+// keyboard layout of the language, the second one is toggled by alt+shift
+const char* os_layout(utils::Language language)
+{
+	switch (language) {
+	case utils::Language::EN: return "us,ru";
+	case utils::Language::RU: return "ru,us";
+	case utils::Language::UK: return "ua,us";
+	case utils::Language::NL: return "nl,ru";
+	case utils::Language::DE: return "de,ru";
+	case utils::Language::FR: return "fr,ru";
+	case utils::Language::ES: return "es,ru";
+	case utils::Language::UNKNOWN: break;
+	}
+	return nullptr;
+}
+
+// setxkbmap takes tens of milliseconds, so the layout is switched on a worker
+// and only when the language changes; a newer switch supersedes the waiting one
+class LayoutSwitcher
+{
+public:
+	~LayoutSwitcher() { if (last) last->wait(); }
+
+	void set(utils::Language language)
+	{
+		const char* layout = os_layout(language);
+		if (!layout || language == current)
+			return;
+		current = language;
+
+		if (last)
+			last->cancel();
+		last = tasks::Executor::shared().submit(tasks::Priority::NORMAL,
+			[this, layout](const tasks::Token& token) {
+				std::lock_guard<std::mutex> lock(mutex);
+				// superseded while waiting for the previous one
+				if (token.cancelled())
+					return;
+				system((std::string("setxkbmap -layout ") + layout + " -option grp:alt_shift_toggle").c_str());
+			});
+	}
+
+private:
+	utils::Language current = utils::Language::UNKNOWN;
+	std::mutex mutex; // the switches run one by one
+	std::optional<tasks::Token> last;
+};
+
+// what the problem needs before its show, made by a worker
+struct Prepared
+{
+	std::string question, solution; // phrases to play
+	utils::Language language = utils::Language::UNKNOWN; // of the solution, with -l
+	bool warming = false; // the phrases are submitted to the warmer
+};
+
+Prepared prepare(const Problem& oriented, bool detect)
+{
+	Prepared prepared;
+	prepared.question = question_phrase(oriented.question());
+	prepared.solution = solution_phrase(oriented.solution());
+	if (detect)
+		prepared.language = utils::what_language(prepared.solution);
+	return prepared;
+}
+
+// the next problem, chosen while the current one is answered
+struct Lookahead
+{
+	int num = -1;
+	bool inverted = false;
+	Problem oriented; // the copy with the orientation of the show
+	std::shared_ptr<Prepared> prepared;
+	tasks::Token token; // of the preparation
+	tasks::Token warming; // of the phrases to play
+
+	void cancel()
+	{
+		token.cancel();
+		warming.cancel();
+	}
+
+	// the preparation and the warming are finished or dropped
+	bool done() const
+	{
+		return !prepared || (token.done() && (!prepared->warming || warming.done()));
+	}
+
+	void wait() const
+	{
+		if (!prepared)
+			return;
+		token.wait();
+		if (prepared->warming)
+			warming.wait();
+	}
+};
+
+// the lookaheads of a session; the warmer may be gone after the session,
+// so their work is stopped and waited by its end, whatever the way out
+class Lookaheads
+{
+public:
+	explicit Lookaheads(const Warmer& warmer) : warmer(warmer) {}
+
+	~Lookaheads()
+	{
+		next.cancel();
+		for (Lookahead& l: passed)
+			l.cancel();
+		if (warmer.interrupt)
+			warmer.interrupt();
+
+		next.wait();
+		for (const Lookahead& l: passed)
+			l.wait();
+	}
+
+	Lookaheads(const Lookaheads&) = delete;
+	Lookaheads& operator= (const Lookaheads&) = delete;
+
+	// of the shown problem, then of the next one
+	Lookahead next;
+
+	// 'next' is superseded, it may be at work yet; the previous ones are not needed anymore
+	void pass()
+	{
+		for (Lookahead& l: passed)
+			l.cancel();
+		passed.erase(std::remove_if(passed.begin(), passed.end(),
+			[](const Lookahead& l) { return l.done(); }), passed.end());
+		passed.push_back(std::move(next));
+	}
+
+private:
+	const Warmer& warmer;
+	std::vector<Lookahead> passed;
+};
+
+// the problem is copied with its orientation, so the worker doesn't read the shared one;
+// the copy shares the lines, it's cheap
+Lookahead look_ahead(const Problem& problem, int num, bool inverted, const Options& options, const Warmer& warm)
+{
+	Lookahead next;
+	next.num = num;
+	next.inverted = inverted;
+	next.prepared = std::make_shared<Prepared>();
+	next.oriented = problem;
+	next.oriented.inverted = inverted;
+
+	const bool detect = options.get(Options::AUTO_LANGUAGE);
+	const bool warm_question = warm.warm && options.get(Options::READ_QUESTION);
+	const bool warm_solution = warm.warm && options.get(Options::PLAY_SOLUTION);
+
+	next.token = tasks::Executor::shared().submit(tasks::Priority::LOW,
+		[oriented = next.oriented, prepared = next.prepared, detect, warm_question, warm_solution,
+			warm = warm.warm, warming = next.warming](const tasks::Token& token) {
+			if (token.cancelled())
+				return;
+			*prepared = prepare(oriented, detect);
+
+			// the rendering may take seconds, the show of the problem doesn't wait for it
+			std::vector<std::pair<std::string, utils::Language>> phrases;
+			if (warm_question)
+				phrases.emplace_back(prepared->question, oriented.question_lang());
+			if (warm_solution)
+				phrases.emplace_back(prepared->solution, oriented.solution_lang());
+			prepared->warming = !phrases.empty();
+			if (prepared->warming)
+				tasks::Executor::shared().submit(tasks::Priority::LOW,
+					[warm, phrases](const tasks::Token& t) {
+						if (!t.cancelled())
+							warm(phrases, t);
+					}, warming);
+		});
+	return next;
+}
+
+} // namespace
+
+void StatisticSaver::save_in_background(const std::vector<std::shared_ptr<Problem>>& problems)
+{
+	auto snapshot = std::make_shared<std::vector<std::shared_ptr<Problem>>>();
+	for (const std::shared_ptr<Problem>& p: problems)
+		snapshot->push_back(std::make_shared<Problem>(*p));
+
+	if (last)
+		last->cancel();
+	last = tasks::Executor::shared().submit(tasks::Priority::NORMAL,
+		[this, snapshot](const tasks::Token&) {
+			std::lock_guard<std::mutex> lock(mutex);
+			Parser::save_statistic(*snapshot, filename);
+		});
+}
+
+void StatisticSaver::save(const std::vector<std::shared_ptr<Problem>>& problems)
+{
+	if (last) {
+		last->cancel();
+		last->wait();
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	Parser::save_statistic(problems, filename);
+}
+
+std::string question_phrase(const std::list<std::string>& question)
+{
+	std::ostringstream ostream_q;
+	std::copy(question.begin(), question.end(), std::ostream_iterator<std::string>(ostream_q, " "));
+	return ostream_q.str();
+}
+
+std::string solution_phrase(const std::list<std::string>& solution)
+{
+	std::ostringstream ostream_s;
+	std::transform(solution.begin(), solution.end(), std::ostream_iterator<std::string>(ostream_s, " "), an::Pattern::plain);
+	return ostream_s.str();
+}
+
+void run(std::vector<std::shared_ptr<Problem>>& problems, const Options& options, view::Screen& screen,
+	StatisticSaver& saver, const Player& play, uint32_t seed, const Warmer& warmer)
+{
+	std::mt19937 generator(seed); // standard mersenne_twister_engine
+
+	std::vector<int> to_solve;
+	for (size_t i = 0; i < problems.size(); ++i) {
+		if (options.get(Options::REPEAT_ERRORS_ONLY)
+		 && problems[i]->last_errors == 0)
+			continue;
+
+		to_solve.push_back(static_cast<int>(i));
+	}
+
+	an::Analyzer analyzer;
+	for (std::shared_ptr<Problem> p: problems)
+		analyzer.prepare(*p, options);
+
+	// answers are checked in memory of the session, so it's not allocated again in the steady state;
+	// every result takes the one slot, the screen may keep it after the session with the memory
+	struct Checked
+	{
+		std::pmr::unsynchronized_pool_resource arena;
+		an::Verification result{ &arena };
+	};
+	auto checked = std::make_shared<Checked>();
+	an::AnswerLines answer;
+
+	int errors_count = 0, solved_count = 0, solving_num = -1;
+	screen.set_time_limit(options.time_limit());
+	LayoutSwitcher layout;
+
+	auto update_statistic = [&]() {
+		Statistics statistics = {
+			static_cast<int>(to_solve.size()),
+			solved_count,
+			errors_count,
+			problems.at(solving_num)->repeat,
+			problems.at(solving_num)->errors,
+			problems.at(solving_num)->total_errors
+		};
+		screen.update_statistic(statistics);
+	};
+
+	// a random one of the problems to solve but the 'previous', if there are others;
+	// the current one may be solved meanwhile, so the choice is checked before the show
+	auto choose = [&](int previous) {
+		std::vector<int> others;
+		std::copy_if(to_solve.begin(), to_solve.end(), std::back_inserter(others),
+			[previous](int i) { return i != previous; });
+		const std::vector<int>& from = others.empty() ? to_solve : others;
+		std::uniform_int_distribution<> distribution (0, from.size() - 1);
+		int num = from[distribution(generator)];
+
+		bool inverted = options.get(Options::QS_INVERTED);
+		if (options.get(Options::QS_MIXED)) {
+			std::uniform_int_distribution<> distribution (0, 1);
+			inverted = distribution(generator) == 0;
+		}
+		return look_ahead(*problems[num], num, inverted, options, warmer);
+	};
+
+	Lookaheads lookaheads(warmer);
+	Lookahead& next = lookaheads.next;
+	while (to_solve.size() != 0) {
+		if (std::find(to_solve.begin(), to_solve.end(), next.num) == to_solve.end()) {
+			next.cancel();
+			lookaheads.pass();
+			next = choose(solving_num);
+		}
+		solving_num = next.num;
+		// made by now mostly, while the previous problem was answered; a quick answer
+		// doesn't wait for the worker, the problem is prepared here then
+		std::shared_ptr<Prepared> prepared = next.prepared;
+		if (!next.token.done()) {
+			next.token.cancel();
+			prepared = std::make_shared<Prepared>(prepare(next.oriented, options.get(Options::AUTO_LANGUAGE)));
+		}
+
+		std::shared_ptr<Problem> problem = problems[solving_num];
+		problem->inverted = next.inverted;
+		problem->not_show_question = options.get(Options::HIDE_QUESTION);
+
+		auto ql = problem->question_lang();
+		auto sl = problem->solution_lang();
+
+		const std::string& question = prepared->question;
+		const std::string& solution = prepared->solution;
+
+		if (options.get(Options::AUTO_LANGUAGE)) {
+			layout.set(prepared->language);
+			screen.set_language(prepared->language);
+		}
+
+		view::Screen::INPUT_STATE input_state;
+
+		if (options.get(Options::LIVE_CHECK)) {
+			auto live_check = std::make_shared<an::LiveCheck>(analyzer, *problem, options);
+			screen.set_live_check([live_check](size_t line_num, std::string_view line)
+				-> const std::vector<an::Error>& {
+				return live_check->update(line_num, line);
+			});
+		}
+
+		try {
+			update_statistic();
+			screen.show_problem(*problem);
+			if (options.get(Options::READ_QUESTION))
+				play(question, ql);
+			// the next one is prepared while this one is answered, the phrases of this one
+			// may be warmed yet
+			lookaheads.pass();
+			next = choose(solving_num);
+			input_state = screen.get_answer(answer);
+		} catch(const std::exception &e) {
+			logging::Error() << e.what() << logging::endl;
+			return;
+		}
+
+		if (input_state == view::Screen::INPUT_STATE::EXIT) {
+			next.cancel();
+			saver.save(problems);
+			return;
+		}
+
+		if (input_state == view::Screen::INPUT_STATE::SKIPPED) {
+			to_solve.erase(std::remove(to_solve.begin(), to_solve.end(), solving_num), to_solve.end());
+			update_statistic();
+			screen.show_solution();
+			screen.show_message("Skipped, press any key to continue");
+			screen.wait_pressed_key();
+			continue;
+		}
+
+		problem->was_attempt = true;
+		// the containers of the previous result go back to the arena, the new ones are moved in
+		checked->result = analyzer.check(*problem, answer, options, &checked->arena);
+		std::shared_ptr<const an::Verification> result(checked, &checked->result);
+
+		if (result->right()) {
+			--problem->repeat;
+			if (problem->repeat == 0) {
+				++solved_count;
+				to_solve.erase(std::remove(to_solve.begin(), to_solve.end(), solving_num), to_solve.end());
+			}
+		} else {
+			problem->repeat = REPEAT_TIMES;
+			++problem->total_errors;
+			++problem->errors;
+			++errors_count;
+		}
+		saver.save_in_background(problems);
+
+		if (options.get(Options::PLAY_SOLUTION))
+			play(solution, sl);
+
+		while (true) {
+			update_statistic();
+			screen.show_result(result);
+			screen.show_message(problem->repeat != 0
+				? "Press space to play the question, F3 to skip it or another key to continue..."
+				: "Press space to play the question or another key to continue...");
+
+			int key = screen.wait_pressed_key();
+			if (key == ' ') {
+				play(solution, sl);
+				continue;
+			} else if (key == view::FKEY::F3 && problem->repeat != 0) {
+				problem->repeat = 0;
+				++solved_count;
+				to_solve.erase(std::remove(to_solve.begin(), to_solve.end(), solving_num), to_solve.end());
+			} else
+				break;
+		}
+	}
+
+	next.cancel();
+	saver.save(problems);
+	update_statistic();
+	screen.show_message("All problems are solved, press eny key to exit");
+	screen.wait_pressed_key();
+}
+
+} // namespace session
@@ -0,0 +1,512 @@
+/*
+ * speech.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <log.h>
+#include <speech.h>
+
+namespace fs = std::filesystem;
+
+namespace speech {
+
+namespace {
+
+bool write_all(int fd, const std::string& s)
+{
+	size_t written = 0;
+	while (written < s.size()) {
+		ssize_t n = ::write(fd, s.data() + written, s.size() - written);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		written += static_cast<size_t>(n);
+	}
+	return true;
+}
+
+// a process, which doesn't know the stop request, is killed after it
+const std::chrono::milliseconds STOP_TIMEOUT(300);
+
+// FNV-1a, the names of the files have to be the same for all builds
+uint64_t stable_hash(std::string_view s, uint64_t hash = 14695981039346656037ull)
+{
+	for (unsigned char c: s) {
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+const char* AUDIO_EXTENSION = ".mp3";
+
+} // namespace
+
+Process::Process(const std::vector<std::string>& command)
+	: _command(command)
+{
+	// a write to the exited process has to fail instead of killing the quiz
+	std::signal(SIGPIPE, SIG_IGN);
+	wake = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+}
+
+Process::~Process()
+{
+	stop();
+	if (wake >= 0)
+		close(wake);
+}
+
+bool Process::start()
+{
+	if (pid > 0)
+		return true;
+
+	int in[2], out[2];
+	if (pipe2(in, O_CLOEXEC) != 0)
+		return false;
+	if (pipe2(out, O_CLOEXEC) != 0) {
+		close(in[0]);
+		close(in[1]);
+		return false;
+	}
+
+	// prepared before fork, the child calls async-signal-safe functions only
+	std::vector<char*> argv;
+	for (const std::string& arg: _command)
+		argv.push_back(const_cast<char*>(arg.c_str()));
+	argv.push_back(nullptr);
+
+	pid_t child = fork();
+	if (child == 0) {
+		dup2(in[0], STDIN_FILENO);
+		dup2(out[1], STDOUT_FILENO);
+		int null = open("/dev/null", O_WRONLY);
+		if (null >= 0)
+			dup2(null, STDERR_FILENO);
+		execvp(argv[0], argv.data());
+		_exit(127);
+	}
+
+	close(in[0]);
+	close(out[1]);
+	if (child < 0) {
+		close(in[1]);
+		close(out[0]);
+		return false;
+	}
+
+	to_process = in[1];
+	from_process = out[0];
+	std::lock_guard<std::mutex> lock(mutex);
+	pid = child;
+	return true;
+}
+
+void Process::stop()
+{
+	pid_t child;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		child = pid;
+		pid = -1;
+	}
+	if (child < 0)
+		return;
+
+	close(to_process);
+	close(from_process);
+	to_process = from_process = -1;
+	received.clear();
+	waitpid(child, nullptr, 0);
+}
+
+void Process::kill()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (pid > 0)
+		::kill(pid, SIGTERM);
+}
+
+void Process::interrupt()
+{
+	uint64_t one = 1;
+	if (wake < 0 || ::write(wake, &one, sizeof(one)) != sizeof(one))
+		kill();
+}
+
+bool Process::exchange(const std::string& line, std::string& answer)
+{
+	return start() && write_all(to_process, line) && receive(answer);
+}
+
+bool Process::receive(std::string& answer)
+{
+	size_t answers = 1;
+	bool stopping = false;
+	std::chrono::steady_clock::time_point deadline;
+
+	for (;;) {
+		size_t end = received.find('\n');
+		if (end != std::string::npos) {
+			// the answer of the request, then the one of the stop
+			if (!stopping || answers == 2)
+				answer = received.substr(0, end);
+			received.erase(0, end + 1);
+			if (--answers == 0)
+				return true;
+			continue;
+		}
+
+		int timeout = -1;
+		if (stopping) {
+			auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+				deadline - std::chrono::steady_clock::now());
+			timeout = static_cast<int>(std::max<std::chrono::milliseconds::rep>(0, left.count()));
+		}
+
+		pollfd fds[2] = { { from_process, POLLIN, 0 }, { wake, POLLIN, 0 } };
+		int n = poll(fds, wake < 0 ? 1 : 2, timeout);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			return false;
+		if (n == 0) {
+			kill();
+			return false;
+		}
+
+		if (fds[1].revents & POLLIN) {
+			uint64_t count;
+			while (::read(wake, &count, sizeof(count)) > 0) {}
+			if (!stopping) {
+				stopping = true;
+				++answers;
+				deadline = std::chrono::steady_clock::now() + STOP_TIMEOUT;
+				if (!write_all(to_process, "stop\n"))
+					return false;
+			}
+		}
+
+		if (fds[0].revents) {
+			char buffer[256];
+			ssize_t r = ::read(from_process, buffer, sizeof(buffer));
+			if (r < 0 && errno == EINTR)
+				continue;
+			if (r <= 0)
+				return false;
+			received.append(buffer, static_cast<size_t>(r));
+		}
+	}
+}
+
+std::string Process::request(const std::string& line, const tasks::Token& token)
+{
+	std::string answer;
+	// an interruption of a former request, the one of this request follows the cancel of its token
+	uint64_t count;
+	while (wake >= 0 && ::read(wake, &count, sizeof(count)) > 0) {}
+	if (token.cancelled())
+		return answer;
+	if (exchange(line, answer))
+		return answer;
+
+	// the process may have exited after the last request
+	stop();
+	if (!token.cancelled() && exchange(line, answer))
+		return answer;
+
+	stop();
+	return std::string();
+}
+
+
+AudioCache::AudioCache(const fs::path& dir, uintmax_t capacity)
+	: dir(dir)
+	, capacity(capacity)
+{
+	std::error_code error;
+	fs::create_directories(dir, error);
+	for (const fs::directory_entry& e: fs::directory_iterator(dir, error))
+		if (e.is_regular_file(error))
+			size += e.file_size(error);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	trim();
+}
+
+fs::path AudioCache::file(std::string_view text, utils::Language language, std::string_view engine) const
+{
+	uint64_t hash = stable_hash(engine);
+	hash = stable_hash(std::string_view("\t", 1), hash);
+	hash = stable_hash(utils::language_code(language), hash);
+	hash = stable_hash(std::string_view("\t", 1), hash);
+	hash = stable_hash(text, hash);
+
+	char name[17];
+	std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+	return dir / (std::string(name) + AUDIO_EXTENSION);
+}
+
+bool AudioCache::use(const fs::path& file)
+{
+	std::error_code error;
+	fs::last_write_time(file, fs::file_time_type::clock::now(), error);
+	return !error;
+}
+
+bool AudioCache::add(const fs::path& file)
+{
+	std::error_code error;
+	uintmax_t file_size = fs::file_size(file, error);
+	if (error)
+		return false;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	size += file_size;
+	trim();
+	return true;
+}
+
+void AudioCache::trim()
+{
+	if (size <= capacity)
+		return;
+
+	struct Entry {
+		fs::file_time_type used;
+		uintmax_t size;
+		fs::path path;
+	};
+
+	std::error_code error;
+	std::vector<Entry> entries;
+	size = 0;
+	for (const fs::directory_entry& e: fs::directory_iterator(dir, error)) {
+		if (!e.is_regular_file(error) || e.path().extension() != AUDIO_EXTENSION)
+			continue;
+		entries.push_back({ e.last_write_time(error), e.file_size(error), e.path() });
+		size += entries.back().size;
+	}
+
+	// down to 3/4 of the capacity, not to trim by every new file
+	std::sort(entries.begin(), entries.end(), [](const Entry& l, const Entry& r) { return l.used < r.used; });
+	for (const Entry& e: entries) {
+		if (size <= capacity / 4 * 3)
+			break;
+		if (fs::remove(e.path, error))
+			size -= e.size;
+	}
+}
+
+std::string request_line(std::string_view verb, const Phrase& phrase, const fs::path& file)
+{
+	std::string line(verb);
+	line.push_back('\t');
+	line.append(utils::language_code(phrase.language));
+	line.push_back('\t');
+
+	// the text is a single field of the protocol
+	for (char c: phrase.text)
+		line.push_back(c == '\n' || c == '\r' || c == '\t' ? ' ' : c);
+
+	if (!file.empty()) {
+		line.push_back('\t');
+		line.append(file.string());
+	}
+	line.push_back('\n');
+	return line;
+}
+
+
+Speaker::Speaker(const std::vector<std::string>& command, tasks::Executor& executor,
+	AudioCache* cache, const std::string& engine)
+	: process(command)
+	, executor(executor)
+	, cache(cache)
+	, engine(engine)
+{
+	submit([this](const tasks::Token&) {
+		std::lock_guard<std::mutex> lock(process_mutex);
+		process.start();
+	});
+}
+
+Speaker::~Speaker()
+{
+	std::vector<tasks::Token> waiting;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (tasks::Token& t: tokens)
+			t.cancel();
+		waiting = tokens;
+	}
+	process.interrupt();
+
+	for (const tasks::Token& t: waiting)
+		t.wait();
+}
+
+void Speaker::submit(std::function<void(const tasks::Token&)> task)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	tokens.erase(std::remove_if(tokens.begin(), tokens.end(),
+		[](const tasks::Token& t) { return t.done(); }), tokens.end());
+	tokens.push_back(executor.submit(tasks::Priority::HIGH, std::move(task)));
+}
+
+void Speaker::say(const std::string& text, utils::Language language)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (tasks::Token& t: tokens)
+			t.cancel();
+	}
+	// stale audio is stopped at once, by the stop request or by the restart of the process
+	if (speaking)
+		process.interrupt();
+
+	submit([this, phrase = Phrase{ text, language }](const tasks::Token& token) {
+		speak(phrase, token);
+	});
+}
+
+void Speaker::wait()
+{
+	std::vector<tasks::Token> waiting;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		waiting = tokens;
+	}
+
+	for (const tasks::Token& t: waiting)
+		t.wait();
+}
+
+void Speaker::speak(const Phrase& phrase, const tasks::Token& token)
+{
+	std::lock_guard<std::mutex> lock(process_mutex);
+	if (token.cancelled())
+		return;
+
+	speaking = true;
+	std::string answer;
+	if (cache) {
+		// a warm cache makes the phrase a file read
+		fs::path file = cache->file(phrase.text, phrase.language, engine);
+		bool cached = cache->use(file);
+		answer = process.request(request_line("play", phrase, file), token);
+		// a stopped phrase may be rendered, the file is complete if it's there
+		if (!cached && !answer.empty())
+			cache->add(file);
+	} else
+		answer = process.request(request_line("say", phrase), token);
+	speaking = false;
+
+	if (answer.empty() && !token.cancelled())
+		logging::Error() << "speech process has failed: " << process.command().front() << logging::endl;
+}
+
+
+Renderer::Renderer(const std::vector<std::string>& command, AudioCache& cache, const std::string& engine)
+	: process(command)
+	, cache(cache)
+	, engine(engine)
+{
+}
+
+bool Renderer::render(const Phrase& phrase, const tasks::Token& token, std::string& error)
+{
+	fs::path file = cache.file(phrase.text, phrase.language, engine);
+	if (cache.use(file))
+		return true;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	{
+		std::lock_guard<std::mutex> rendering_lock(rendering_mutex);
+		rendering = token;
+	}
+	std::string answer = process.request(request_line("render", phrase, file), token);
+	{
+		std::lock_guard<std::mutex> rendering_lock(rendering_mutex);
+		rendering.reset();
+	}
+	// a process without the audio files answers ok too
+	if (answer == "ok" && cache.add(file))
+		return true;
+
+	error = answer;
+	return false;
+}
+
+void Renderer::interrupt()
+{
+	// a stale wake of the process is dropped by its next request
+	std::lock_guard<std::mutex> lock(rendering_mutex);
+	if (rendering && rendering->cancelled())
+		process.interrupt();
+}
+
+
+size_t prerender(const std::vector<std::string>& command, const std::string& engine,
+	AudioCache& cache, const std::vector<Phrase>& phrases, unsigned threads)
+{
+	std::vector<std::pair<const Phrase*, fs::path>> missed;
+	for (const Phrase& p: phrases) {
+		fs::path file = cache.file(p.text, p.language, engine);
+		if (cache.use(file))
+			continue;
+		if (std::none_of(missed.begin(), missed.end(),
+			[&file](const std::pair<const Phrase*, fs::path>& m) { return m.second == file; }))
+			missed.emplace_back(&p, file);
+	}
+
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	threads = static_cast<unsigned>(std::min<size_t>(threads, missed.size()));
+
+	std::atomic<size_t> next(0), rendered(0);
+
+	// a speech process per worker, the phrases are taken one by one
+	auto worker = [&](const tasks::Token& token) {
+		Renderer renderer(command, cache, engine);
+		size_t i;
+		std::string error;
+		while ((i = next++) < missed.size()) {
+			if (renderer.render(*missed[i].first, token, error))
+				++rendered;
+			else
+				logging::Error() << "not rendered: " << missed[i].first->text
+					<< (error.empty() ? std::string() : ": " + error) << logging::endl;
+		}
+	};
+
+	if (threads == 0)
+		return 0;
+
+	tasks::Executor executor(threads);
+	for (unsigned t = 0; t < threads; ++t)
+		executor.submit(tasks::Priority::LOW, worker);
+	executor.wait();
+
+	return rendered;
+}
+
+} // namespace speech
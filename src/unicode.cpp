@@ -0,0 +1,262 @@
+/*
+ * unicode.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include <utils.h>
+
+namespace utils {
+
+namespace {
+
+// simple case folding (CaseFolding.txt, statuses C and S) of the scripts used in the decks:
+// Latin, Greek and Cyrillic, length of a string in code points is kept
+struct FoldRange {
+	char32_t first, last;
+	int32_t delta;
+	char32_t stride; // 2 - only every second code point is an upper case one
+};
+
+constexpr FoldRange FOLD_RANGES[] = {
+	{ 0x0041, 0x005A,   32, 1 }, // A-Z
+	{ 0x00B5, 0x00B5,  775, 1 }, // micro sign -> greek mu
+	{ 0x00C0, 0x00D6,   32, 1 },
+	{ 0x00D8, 0x00DE,   32, 1 },
+	{ 0x0100, 0x012E,    1, 2 },
+	{ 0x0132, 0x0136,    1, 2 },
+	{ 0x0139, 0x0147,    1, 2 },
+	{ 0x014A, 0x0176,    1, 2 },
+	{ 0x0178, 0x0178, -121, 1 }, // Y with diaeresis
+	{ 0x0179, 0x017D,    1, 2 },
+	{ 0x017F, 0x017F, -268, 1 }, // long s
+	{ 0x0386, 0x0386,   38, 1 },
+	{ 0x0388, 0x038A,   37, 1 },
+	{ 0x038C, 0x038C,   64, 1 },
+	{ 0x038E, 0x038F,   63, 1 },
+	{ 0x0391, 0x03A1,   32, 1 },
+	{ 0x03A3, 0x03AB,   32, 1 },
+	{ 0x03C2, 0x03C2,    1, 1 }, // final sigma
+	{ 0x0400, 0x040F,   80, 1 },
+	{ 0x0410, 0x042F,   32, 1 },
+	{ 0x0460, 0x0480,    1, 2 },
+	{ 0x048A, 0x04BE,    1, 2 },
+	{ 0x04C0, 0x04C0,   15, 1 },
+	{ 0x04C1, 0x04CD,    1, 2 },
+	{ 0x04D0, 0x052E,    1, 2 },
+	{ 0x1E00, 0x1E94,    1, 2 },
+	{ 0x1E9E, 0x1E9E, -7615, 1 }, // capital sharp s -> sharp s
+	{ 0x1EA0, 0x1EFE,    1, 2 },
+	{ 0xFF21, 0xFF3A,   32, 1 }, // fullwidth A-Z
+};
+
+constexpr char32_t fold_by_ranges(char32_t c)
+{
+	for (const FoldRange& r: FOLD_RANGES)
+		if (c >= r.first && c <= r.last && (c - r.first) % r.stride == 0)
+			return static_cast<char32_t>(static_cast<int32_t>(c) + r.delta);
+	return c;
+}
+
+// Latin, Greek and Cyrillic blocks are looked up directly
+constexpr char32_t FOLD_TABLE_SIZE = 0x0530;
+
+constexpr std::array<char16_t, FOLD_TABLE_SIZE> make_fold_table()
+{
+	std::array<char16_t, FOLD_TABLE_SIZE> table = {};
+	for (char32_t c = 0; c < FOLD_TABLE_SIZE; ++c)
+		table[c] = static_cast<char16_t>(fold_by_ranges(c));
+	return table;
+}
+
+constexpr std::array<char16_t, FOLD_TABLE_SIZE> FOLD_TABLE = make_fold_table();
+
+static_assert(FOLD_TABLE[U'Ä'] == U'ä', "case folding table is broken");
+static_assert(FOLD_TABLE[U'Ё'] == U'ё', "case folding table is broken");
+static_assert(FOLD_TABLE[U'Ї'] == U'ї', "case folding table is broken");
+
+// canonical compositions of the decks' letters: <base, combining mark, composed>,
+// sorted by base and mark
+struct Composition {
+	char32_t base, mark, composed;
+};
+
+constexpr char32_t GRAVE      = 0x0300;
+constexpr char32_t ACUTE      = 0x0301;
+constexpr char32_t CIRCUMFLEX = 0x0302;
+constexpr char32_t TILDE      = 0x0303;
+constexpr char32_t BREVE      = 0x0306;
+constexpr char32_t DIAERESIS  = 0x0308;
+constexpr char32_t RING       = 0x030A;
+constexpr char32_t CARON      = 0x030C;
+constexpr char32_t CEDILLA    = 0x0327;
+
+constexpr Composition COMPOSITIONS[] = {
+	{ U'A', GRAVE, U'À' }, { U'A', ACUTE, U'Á' }, { U'A', CIRCUMFLEX, U'Â' }, { U'A', TILDE, U'Ã' },
+	{ U'A', DIAERESIS, U'Ä' }, { U'A', RING, U'Å' },
+	{ U'C', CARON, U'Č' }, { U'C', CEDILLA, U'Ç' },
+	{ U'E', GRAVE, U'È' }, { U'E', ACUTE, U'É' }, { U'E', CIRCUMFLEX, U'Ê' }, { U'E', DIAERESIS, U'Ë' },
+	{ U'I', GRAVE, U'Ì' }, { U'I', ACUTE, U'Í' }, { U'I', CIRCUMFLEX, U'Î' }, { U'I', DIAERESIS, U'Ï' },
+	{ U'N', TILDE, U'Ñ' },
+	{ U'O', GRAVE, U'Ò' }, { U'O', ACUTE, U'Ó' }, { U'O', CIRCUMFLEX, U'Ô' }, { U'O', TILDE, U'Õ' },
+	{ U'O', DIAERESIS, U'Ö' },
+	{ U'S', CARON, U'Š' },
+	{ U'U', GRAVE, U'Ù' }, { U'U', ACUTE, U'Ú' }, { U'U', CIRCUMFLEX, U'Û' }, { U'U', DIAERESIS, U'Ü' },
+	{ U'Y', ACUTE, U'Ý' }, { U'Y', DIAERESIS, U'Ÿ' },
+	{ U'Z', CARON, U'Ž' },
+	{ U'a', GRAVE, U'à' }, { U'a', ACUTE, U'á' }, { U'a', CIRCUMFLEX, U'â' }, { U'a', TILDE, U'ã' },
+	{ U'a', DIAERESIS, U'ä' }, { U'a', RING, U'å' },
+	{ U'c', CARON, U'č' }, { U'c', CEDILLA, U'ç' },
+	{ U'e', GRAVE, U'è' }, { U'e', ACUTE, U'é' }, { U'e', CIRCUMFLEX, U'ê' }, { U'e', DIAERESIS, U'ë' },
+	{ U'i', GRAVE, U'ì' }, { U'i', ACUTE, U'í' }, { U'i', CIRCUMFLEX, U'î' }, { U'i', DIAERESIS, U'ï' },
+	{ U'n', TILDE, U'ñ' },
+	{ U'o', GRAVE, U'ò' }, { U'o', ACUTE, U'ó' }, { U'o', CIRCUMFLEX, U'ô' }, { U'o', TILDE, U'õ' },
+	{ U'o', DIAERESIS, U'ö' },
+	{ U's', CARON, U'š' },
+	{ U'u', GRAVE, U'ù' }, { U'u', ACUTE, U'ú' }, { U'u', CIRCUMFLEX, U'û' }, { U'u', DIAERESIS, U'ü' },
+	{ U'y', ACUTE, U'ý' }, { U'y', DIAERESIS, U'ÿ' },
+	{ U'z', CARON, U'ž' },
+	{ U'І', DIAERESIS, U'Ї' },
+	{ U'Е', DIAERESIS, U'Ё' },
+	{ U'И', BREVE, U'Й' },
+	{ U'У', BREVE, U'Ў' },
+	{ U'е', DIAERESIS, U'ё' },
+	{ U'и', BREVE, U'й' },
+	{ U'у', BREVE, U'ў' },
+	{ U'і', DIAERESIS, U'ї' },
+};
+
+constexpr bool compositions_sorted()
+{
+	for (size_t i = 1; i < sizeof(COMPOSITIONS) / sizeof(COMPOSITIONS[0]); ++i) {
+		const Composition& l = COMPOSITIONS[i - 1];
+		const Composition& r = COMPOSITIONS[i];
+		if (l.base > r.base || (l.base == r.base && l.mark >= r.mark))
+			return false;
+	}
+	return true;
+}
+
+static_assert(compositions_sorted(), "compositions have to be sorted for the binary search");
+
+// singletons, which NFC replaces in any context
+constexpr Composition SINGLETONS[] = {
+	{ 0x2126, 0, U'Ω' }, // ohm sign
+	{ 0x212A, 0, U'K' }, // kelvin sign
+	{ 0x212B, 0, U'Å' }, // angstrom sign
+};
+
+bool is_combining_mark(char32_t c)
+{
+	return c >= 0x0300 && c <= 0x036F;
+}
+
+template <typename String>
+void fold_case_string(String& s)
+{
+	// none of the foldings makes utf8 longer (ẞ -> ß is shorter), so it is done in place
+	char* out = &s[0];
+	size_t i = 0;
+	while (i < s.size()) {
+		unsigned char c = static_cast<unsigned char>(s[i]);
+		if (c < 0x80) {
+			*out++ = (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+			++i;
+			continue;
+		}
+		out = encode_utf8(out, fold_case(next_code_point(s, i)));
+	}
+	s.resize(out - s.data());
+}
+
+char32_t compose(char32_t base, char32_t mark)
+{
+	auto it = std::lower_bound(std::begin(COMPOSITIONS), std::end(COMPOSITIONS), Composition{ base, mark, 0 },
+		[](const Composition& l, const Composition& r) {
+			return l.base < r.base || (l.base == r.base && l.mark < r.mark);
+		});
+
+	if (it != std::end(COMPOSITIONS) && it->base == base && it->mark == mark)
+		return it->composed;
+	return 0;
+}
+
+
+template <typename String>
+void normalize_string(String& s)
+{
+	// combining marks are encoded as 0xCC 0x80 - 0xCD 0xAF, the singletons start with 0xE2 0x84
+	auto needs_normalization = [](std::string_view s) {
+		for (unsigned char c: s)
+			if (c == 0xCC || c == 0xCD || c == 0xE2)
+				return true;
+		return false;
+	};
+
+	if (!needs_normalization(s))
+		return;
+
+	// a composition is never longer in utf8 than its parts, so it is done in place
+	char* out = &s[0];
+	char* last = nullptr; // the last written code point
+	char32_t last_code_point = 0;
+	size_t i = 0;
+	while (i < s.size()) {
+		char32_t c = next_code_point(s, i);
+		auto singleton = std::find_if(std::begin(SINGLETONS), std::end(SINGLETONS),
+			[c](const Composition& s) { return s.base == c; });
+		if (singleton != std::end(SINGLETONS))
+			c = singleton->composed;
+
+		char32_t composed = is_combining_mark(c) && last ? compose(last_code_point, c) : 0;
+		if (composed != 0) {
+			out = encode_utf8(last, composed);
+			last_code_point = composed;
+		} else {
+			last = out;
+			last_code_point = c;
+			out = encode_utf8(out, c);
+		}
+	}
+	s.resize(out - s.data());
+}
+
+} // namespace
+
+char32_t fold_case(char32_t c)
+{
+	if (c < FOLD_TABLE_SIZE)
+		return FOLD_TABLE[c];
+	if (c < 0x1E00)
+		return c;
+	return fold_by_ranges(c);
+}
+
+void fold_case(std::string& s)
+{
+	fold_case_string(s);
+}
+
+void fold_case(std::pmr::string& s)
+{
+	fold_case_string(s);
+}
+
+void normalize(std::string& s)
+{
+	normalize_string(s);
+}
+
+void normalize(std::pmr::string& s)
+{
+	normalize_string(s);
+}
+
+} // namespace utils
@@ -8,10 +8,12 @@
  */
 
 #include <algorithm>
+#include <cstdint>
 #include <stdexcept>
-#include <map>
 
-#include <cwctype>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include <utils.h>
 
@@ -38,72 +40,323 @@ void remove_duplicate_spaces(std::string& src)
 	src.erase(std::unique(src.begin(), src.end(), adjacent_spaces), src.end());
 }
 
-void to_lower(std::u16string& src)
+namespace {
+
+const char* INVALID_UTF8 = "invalid utf8 symbol";
+
+// length of the leading ASCII run, 16 bytes at a time
+size_t ascii_prefix(const uint8_t* s, size_t n)
 {
-	std::transform(src.begin(), src.end(), src.begin(), ::towlower);
+	size_t i = 0;
+#ifdef __SSE2__
+	for (; i + 16 <= n; i += 16) {
+		if (s[i] >= 0x80)
+			return i;
+		int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i)));
+		if (mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+#endif
+	while (i < n && s[i] < 0x80) ++i;
+	return i;
 }
 
-std::u16string to_utf16(const std::string& in)
+// returns length of the sequence in bytes, 0 for invalid sequences
+size_t decode(const uint8_t* s, size_t n, char32_t& c)
+{
+	if (s[0] < 0x80) {
+		c = s[0];
+		return 1;
+	}
+
+	size_t length;
+	char32_t min;
+	if ((s[0] >> 5) == 0x06) {
+		length = 2; min = 0x80; c = s[0] & 0x1F;
+	} else if ((s[0] >> 4) == 0x0E) {
+		length = 3; min = 0x800; c = s[0] & 0x0F;
+	} else if ((s[0] >> 3) == 0x1E) {
+		length = 4; min = 0x10000; c = s[0] & 0x07;
+	} else
+		return 0;
+
+	if (length > n)
+		return 0;
+
+	for (size_t i = 1; i < length; ++i) {
+		if ((s[i] & 0xC0) != 0x80)
+			return 0;
+		c = (c << 6) | (s[i] & 0x3F);
+	}
+
+	// overlong forms, surrogates and out of Unicode range
+	if (c < min || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF))
+		return 0;
+
+	return length;
+}
+
+template <typename F>
+void for_each_code_point(std::string_view in, F f)
 {
-	std::u16string out;
 	const uint8_t* s = reinterpret_cast<const uint8_t*>(in.data());
-	while (*s) {
-		if (*s < 0x80) {
-			out.push_back(*s);
-			s += 1;
-		} else if ((*s >> 5) == 0x06) {
-			out.push_back(((*s << 6) & 0x7FF) + (*(s+1) & 0x3F)); // integral promotion
-			s += 2;
-		} else if ((*s >> 4) == 0x0E) {
-			out.push_back(((*s << 12) & 0xFFFF) + ((*(s+1) << 6) & 0xFFF) + ((*(s+2)) & 0x3F));
-			s += 3;
-		} else
-			throw std::runtime_error("invalid utf8 symbol");
+	size_t n = in.size(), i = 0;
+	while (i < n) {
+		if (s[i] < 0x80) { // ASCII run
+			size_t end = i + ascii_prefix(s + i, n - i);
+			for (; i < end; ++i)
+				f(static_cast<char32_t>(s[i]));
+			continue;
+		}
+
+		// two octets, the most of non-ASCII text in the decks
+		if (s[i] >= 0xC2 && s[i] < 0xE0 && i + 1 < n && (s[i + 1] & 0xC0) == 0x80) {
+			f(static_cast<char32_t>(((s[i] & 0x1F) << 6) | (s[i + 1] & 0x3F)));
+			i += 2;
+			continue;
+		}
+
+		char32_t c;
+		size_t length = decode(s + i, n - i, c);
+		if (length == 0)
+			throw std::runtime_error(INVALID_UTF8);
+		f(c);
+		i += length;
 	}
+}
+
+} // namespace
 
+bool is_valid_utf8(std::string_view in)
+{
+	const uint8_t* s = reinterpret_cast<const uint8_t*>(in.data());
+	size_t n = in.size(), i = 0;
+	while ((i += ascii_prefix(s + i, n - i)) < n) {
+		if (s[i] >= 0xC2 && s[i] < 0xE0 && i + 1 < n && (s[i + 1] & 0xC0) == 0x80) {
+			i += 2;
+			continue;
+		}
+
+		char32_t c;
+		size_t length = decode(s + i, n - i, c);
+		if (length == 0)
+			return false;
+		i += length;
+	}
+	return true;
+}
+
+size_t utf8_length(std::string_view in)
+{
+	// every byte except continuation ones (10xxxxxx) starts a code point
+	const uint8_t* s = reinterpret_cast<const uint8_t*>(in.data());
+	size_t n = in.size(), i = 0, length = 0;
+#ifdef __SSE2__
+	const __m128i continuation_max = _mm_set1_epi8(static_cast<char>(0xBF));
+	for (; i + 16 <= n; i += 16) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+		// signed compare: continuation bytes are -128..-65
+		int mask = _mm_movemask_epi8(_mm_cmpgt_epi8(chunk, continuation_max));
+		length += __builtin_popcount(mask);
+	}
+#endif
+	for (; i < n; ++i)
+		length += (s[i] & 0xC0) != 0x80;
+	return length;
+}
+
+size_t utf8_offset(std::string_view s, size_t n)
+{
+	size_t pos = 0;
+	for (; n > 0 && pos < s.size(); --n)
+		next_code_point(s, pos);
+	return pos;
+}
+
+char32_t next_code_point(std::string_view in, size_t& pos)
+{
+	const uint8_t* s = reinterpret_cast<const uint8_t*>(in.data());
+	char32_t c;
+	size_t length = decode(s + pos, in.size() - pos, c);
+	if (length == 0)
+		throw std::runtime_error(INVALID_UTF8);
+	pos += length;
+	return c;
+}
+
+char* encode_utf8(char* out, char32_t c)
+{
+	if (c < 0x80) {           // one octet
+		*out++ = static_cast<char>(c);
+	} else if (c < 0x800) {   // two octets
+		*out++ = static_cast<char>((c >> 6)           | 0xC0);
+		*out++ = static_cast<char>((c & 0x3F)         | 0x80);
+	} else if (c < 0x10000) { // three octets
+		*out++ = static_cast<char>((c >> 12)          | 0xE0);
+		*out++ = static_cast<char>(((c >> 6) & 0x3F)  | 0x80);
+		*out++ = static_cast<char>((c & 0x3F)         | 0x80);
+	} else {                  // four octets
+		*out++ = static_cast<char>((c >> 18)          | 0xF0);
+		*out++ = static_cast<char>(((c >> 12) & 0x3F) | 0x80);
+		*out++ = static_cast<char>(((c >> 6) & 0x3F)  | 0x80);
+		*out++ = static_cast<char>((c & 0x3F)         | 0x80);
+	}
+	return out;
+}
+
+void append_utf8(std::string& out, char32_t c)
+{
+	char buffer[4];
+	out.append(buffer, encode_utf8(buffer, c) - buffer);
+}
+
+// the outputs are allocated for the worst case and written without bounds checks
+
+std::u16string to_utf16(std::string_view in)
+{
+	std::u16string out(in.size(), u'\0');
+	char16_t* o = &out[0];
+	for_each_code_point(in, [&o](char32_t c) {
+		if (c < 0x10000) {
+			*o++ = static_cast<char16_t>(c);
+		} else { // surrogate pair
+			c -= 0x10000;
+			*o++ = static_cast<char16_t>(0xD800 + (c >> 10));
+			*o++ = static_cast<char16_t>(0xDC00 + (c & 0x3FF));
+		}
+	});
+	out.resize(o - out.data());
+	return out;
+}
+
+std::u32string to_utf32(std::string_view in)
+{
+	std::u32string out(in.size(), U'\0');
+	char32_t* o = &out[0];
+	for_each_code_point(in, [&o](char32_t c) { *o++ = c; });
+	out.resize(o - out.data());
 	return out;
 }
 
 std::string to_utf8(const std::u16string& in)
 {
-	std::string out;
-	for (uint16_t wc: in) {
-		if (wc < 0x80)         // one octet
-			out.push_back(static_cast<uint8_t>(wc));
-		else if (wc < 0x800) { // two octets
-			out.push_back(static_cast<uint8_t>((wc >> 6)          | 0xC0));
-			out.push_back(static_cast<uint8_t>((wc & 0x3F)        | 0x80));
-		} else {               // three octets
-			out.push_back(static_cast<uint8_t>((wc >> 12)         | 0xE0));
-			out.push_back(static_cast<uint8_t>(((wc >> 6) & 0x3F) | 0x80));
-			out.push_back(static_cast<uint8_t>((wc & 0x3F)        | 0x80));
+	std::string out(in.size() * 3, '\0');
+	char* o = &out[0];
+	for (size_t i = 0; i < in.size(); ++i) {
+		char32_t c = in[i];
+		if (c >= 0xD800 && c <= 0xDBFF && i + 1 < in.size()
+		 && in[i + 1] >= 0xDC00 && in[i + 1] <= 0xDFFF) {
+			c = 0x10000 + ((c - 0xD800) << 10) + (in[i + 1] - 0xDC00);
+			++i;
 		}
+		o = encode_utf8(o, c);
 	}
+	out.resize(o - out.data());
+	return out;
+}
+
+std::string to_utf8(const std::u32string& in)
+{
+	std::string out(in.size() * 4, '\0');
+	char* o = &out[0];
+	for (char32_t c: in)
+		o = encode_utf8(o, c);
+	out.resize(o - out.data());
 	return out;
 }
 
-Language what_language(const std::u16string& s) {
-	std::map<Language, int> langs ;
-	for (char16_t c: s) {
-		if (c >= 0x0410 && c < 0x044F) {
-			langs[Language::RU]++;
-		} else if (c >= 0x0041 && c < 0x007a) {
-			langs[Language::EN]++;
-		} else {
-			langs[Language::UNKNOWN]++;
+namespace {
+
+// pattern bit masks of symbols, open addressing table on the stack
+class SymbolMasks
+{
+	static const size_t SIZE = 128; // at least twice as many as the pattern symbols
+	char32_t symbols[SIZE];
+	uint64_t masks[SIZE] = {};
+
+	size_t slot(char32_t c) const {
+		size_t i = (c * 2654435761u) % SIZE;
+		while (masks[i] != 0 && symbols[i] != c)
+			i = (i + 1) % SIZE;
+		return i;
+	}
+
+public:
+	explicit SymbolMasks(const std::u32string& pattern) {
+		for (size_t i = 0; i < pattern.size(); ++i) {
+			size_t s = slot(pattern[i]);
+			symbols[s] = pattern[i];
+			masks[s] |= uint64_t(1) << i;
 		}
 	}
 
-	int max = 0;
-	Language result = Language::UNKNOWN;
-	for (auto p: langs) {
-		if (p.second > max) {
-			max = p.second;
-			result = p.first;
+	uint64_t operator[](char32_t c) const { return masks[slot(c)]; }
+};
+
+size_t edit_distance_dp(const std::u32string& p, const std::u32string& t, size_t max_distance)
+{
+	std::vector<size_t> row(p.size() + 1);
+	for (size_t i = 0; i <= p.size(); ++i)
+		row[i] = i;
+
+	for (size_t j = 1; j <= t.size(); ++j) {
+		size_t diagonal = row[0], row_min = ++row[0];
+		for (size_t i = 1; i <= p.size(); ++i) {
+			size_t up = row[i];
+			row[i] = std::min({ row[i] + 1, row[i - 1] + 1, diagonal + (p[i - 1] != t[j - 1]) });
+			diagonal = up;
+			row_min = std::min(row_min, row[i]);
 		}
+		if (row_min > max_distance)
+			return max_distance + 1;
+	}
+
+	return std::min(row.back(), max_distance + 1);
+}
+
+} // namespace
+
+// Myers' bit-vector algorithm in Hyyrö's formulation for the distance of whole strings
+size_t edit_distance(const std::u32string& a, const std::u32string& b, size_t max_distance)
+{
+	const std::u32string& p = a.size() <= b.size() ? a : b; // pattern is the shorter one
+	const std::u32string& t = a.size() <= b.size() ? b : a;
+	size_t m = p.size(), n = t.size();
+
+	if (n - m > max_distance)
+		return max_distance + 1;
+	if (m == 0)
+		return n;
+	if (m > 64)
+		return edit_distance_dp(p, t, max_distance);
+
+	SymbolMasks peq(p);
+	const uint64_t last = uint64_t(1) << (m - 1);
+	uint64_t pv = ~uint64_t(0), mv = 0;
+	size_t score = m;
+
+	for (size_t j = 0; j < n; ++j) {
+		uint64_t eq = peq[t[j]];
+		uint64_t xv = eq | mv;
+		uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+		uint64_t ph = mv | ~(xh | pv);
+		uint64_t mh = pv & xh;
+
+		if (ph & last) ++score;
+		else if (mh & last) --score;
+
+		// the first row is 0, 1, 2, ... for the whole strings
+		ph = (ph << 1) | 1;
+		mh <<= 1;
+		pv = mh | ~(xv | ph);
+		mv = ph & xv;
+
+		// every remaining symbol decreases the distance by one at most
+		if (score > max_distance + (n - j - 1))
+			return max_distance + 1;
 	}
 
-	return result;
+	return std::min(score, max_distance + 1);
 }
 
 std::vector<std::string> split(const std::string& line, const std::string& delimeter)
@@ -132,5 +385,14 @@ std::vector<std::string> split(const std::string& line, const std::string& delim
 	return tokens;
 }
 
+size_t hash_lines(const std::list<std::string>& lines)
+{
+	// the hash of every line is mixed in, so the line boundaries count
+	size_t h = lines.size();
+	for (const std::string& line: lines)
+		h ^= std::hash<std::string>()(line) + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+	return h;
+}
+
 
 } // namespace utils
@@ -0,0 +1,242 @@
+/*
+ * headless_screen.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#include <algorithm>
+#include <cctype>
+
+#include <headless_screen.h>
+
+namespace view {
+
+namespace headless {
+
+namespace {
+
+const int TAB_WIDTH = 4;
+
+} // namespace
+
+HeadlessScreen::HeadlessScreen(bool enter_accept_mode, int height, int width)
+	: enter_accept_mode(enter_accept_mode)
+	, height(std::max(height, 8))
+	, width(std::max(width, 20))
+	, grid(this->height, std::u32string(this->width, U' '))
+{
+	draw();
+}
+
+void HeadlessScreen::type(std::string_view text)
+{
+	for (char32_t c: utils::to_utf32(text))
+		script.push_back({ Input::Key::CHARACTER, c });
+}
+
+void HeadlessScreen::press(Input::Key key)
+{
+	script.push_back({ key });
+}
+
+std::string HeadlessScreen::row(int y) const
+{
+	std::u32string cells = grid[y];
+	cells.erase(cells.find_last_not_of(U' ') + 1);
+	return utils::to_utf8(cells);
+}
+
+bool HeadlessScreen::shows(std::string_view text) const
+{
+	for (int y = 0; y < height; ++y)
+		if (row(y).find(text) != std::string::npos)
+			return true;
+	return false;
+}
+
+Input HeadlessScreen::next()
+{
+	if (script.empty())
+		return { Input::Key::F12 };
+
+	Input input = script.front();
+	script.pop_front();
+	return input;
+}
+
+Screen::INPUT_STATE HeadlessScreen::get_answer(analysis::AnswerLines& answer)
+{
+	answer.clear();
+	for (;;) {
+		Input input = next();
+		bool enter = input.key == Input::Key::CHARACTER && input.code == '\n';
+
+		if (input.key == Input::Key::F2 || (enter_accept_mode && enter)) {
+			answer.assign(lines.begin(), lines.end());
+			return INPUT_STATE::ENTERED;
+		} else if (input.key == Input::Key::F3)
+			return INPUT_STATE::SKIPPED;
+		else if (input.key == Input::Key::F12)
+			return INPUT_STATE::EXIT;
+
+		Clock::time_point start = Clock::now();
+		edit(input);
+		if (live_check)
+			live_check(lines.size() - 1, lines.back());
+		draw();
+		latencies.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+	}
+}
+
+// the answer is typed at its end
+void HeadlessScreen::edit(const Input& input)
+{
+	std::string& line = lines.back();
+	if (input.key == Input::Key::BACKSPACE) {
+		if (!line.empty()) {
+			size_t i = line.size() - 1;
+			while (i > 0 && (static_cast<unsigned char>(line[i]) & 0xC0) == 0x80)
+				--i;
+			line.erase(i);
+		} else if (lines.size() > 1)
+			lines.pop_back();
+	} else if (input.code == '\n')
+		lines.emplace_back();
+	else
+		utils::append_utf8(line, input.code);
+}
+
+int HeadlessScreen::wait_pressed_key()
+{
+	Input input = next();
+	if (input.key == Input::Key::F3)
+		return FKEY::F3;
+	return input.key == Input::Key::CHARACTER ? static_cast<int>(input.code) : 0;
+}
+
+void HeadlessScreen::set_language(utils::Language l)
+{
+	language = l;
+}
+
+void HeadlessScreen::update_statistic(const Statistics& s)
+{
+	statistics = s;
+	draw();
+}
+
+void HeadlessScreen::show_problem(const Problem& problem)
+{
+	question = problem.not_show_question ? nullptr : problem.shared_question();
+	solution = problem.shared_solution();
+	verification.reset();
+	solution_visible = false;
+	mode = Mode::INPUT;
+	lines = { std::string() };
+	message = "F2 - check answer       F3 - skip question       F12 - exit ";
+	draw();
+}
+
+void HeadlessScreen::set_live_check(const LiveCheck& check)
+{
+	live_check = check;
+}
+
+void HeadlessScreen::show_result(const std::shared_ptr<const analysis::Verification>& v)
+{
+	verification = v;
+	mode = Mode::OUTPUT;
+	solution_visible = true;
+	draw();
+}
+
+void HeadlessScreen::show_solution()
+{
+	solution_visible = true;
+	draw();
+}
+
+void HeadlessScreen::show_message(const std::string& m)
+{
+	message = m;
+	draw();
+}
+
+// tabs are expanded, a code point takes a cell
+void HeadlessScreen::draw_text(int y, int x, std::string_view text)
+{
+	if (y < 0 || y >= height)
+		return;
+	x = std::max(x, 0);
+
+	for (char32_t c: utils::to_utf32(text)) {
+		if (c == '\t') {
+			x += TAB_WIDTH - x % TAB_WIDTH;
+			continue;
+		}
+		if (x >= width)
+			return;
+		grid[y][x++] = c;
+	}
+}
+
+// the layout of the terminal screen: statistic, question, answer, solution and message,
+// every part but the message ends with a separator
+void HeadlessScreen::draw()
+{
+	for (std::u32string& r: grid)
+		std::fill(r.begin(), r.end(), U' ');
+
+	const int statistic_h = 2, message_h = 1;
+	const int ques_h = (height - statistic_h - message_h) * 2 / 7 - 1;
+	const int answ_h = (height - statistic_h - ques_h - message_h) / 2 + 1;
+	const int resl_h = height - statistic_h - ques_h - message_h - answ_h;
+
+	const std::list<std::string> none;
+	auto draw_part = [this](int top, int h, const auto& content) {
+		int y = top;
+		for (const auto& line: content) {
+			if (y >= top + h - 1)
+				break;
+			draw_text(y++, 0, line);
+		}
+		std::fill(grid[top + h - 1].begin(), grid[top + h - 1].end(), U'-');
+	};
+
+	draw_text(0, 1, "Left:[" + std::to_string(statistics.left_problems) + "]; Solved:["
+		+ std::to_string(statistics.solved_problems) + "]; Errors:[" + std::to_string(statistics.errors) + "]");
+	const std::string problem = "PROBLEM: Repeat:[" + std::to_string(statistics.problem_repeat_times)
+		+ "]; Errors:[" + std::to_string(statistics.problem_errors)
+		+ "]; Total errors:[" + std::to_string(statistics.problem_total_errors) + "]";
+	draw_text(0, width - static_cast<int>(problem.size()) - 1, problem);
+	draw_part(0, statistic_h, none);
+
+	draw_part(statistic_h, ques_h, question ? question->list : none);
+
+	const int answer_top = statistic_h + ques_h;
+	if (mode == Mode::INPUT) {
+		draw_part(answer_top, answ_h, lines);
+	} else if (mode == Mode::OUTPUT) {
+		std::vector<std::string> result(verification->answer.begin(), verification->answer.end());
+		result.emplace_back();
+		result.push_back(verification->right() ? "[right]" : "[invalid answer]");
+		draw_part(answer_top, answ_h, result);
+	} else
+		draw_part(answer_top, answ_h, none);
+
+	draw_part(answer_top + answ_h, resl_h, solution_visible && solution ? solution->list : none);
+
+	draw_text(height - 1, 1, message);
+	std::string code = utils::language_code(language);
+	std::transform(code.begin(), code.end(), code.begin(), ::toupper);
+	draw_text(height - 1, width - static_cast<int>(code.size()) - 1, code);
+
+	++frame_count;
+}
+
+} // namespace headless
+
+} // namespace view
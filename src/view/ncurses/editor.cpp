@@ -9,160 +9,321 @@
 
 #include <editor.h>
 
-bool Editor::is_ascii(char c) { return c > 0; }
-size_t Editor::sym_width(char c) { return is_ascii(c) ? ascii_width : utf8_width; }
+#include <algorithm>
+#include <cwchar>
 
-void Editor::put_cursor_inside_line()
+#include <utils.h>
+
+namespace {
+
+// the gap is made at least so large, then it doubles with the line
+const size_t MIN_GAP = 64;
+
+} // namespace
+
+GapBuffer::GapBuffer(std::string_view s)
+	: buffer(s)
+	, gap_begin(s.size())
+	, gap_end(s.size())
+{
+}
+
+void GapBuffer::move_gap(size_t pos)
+{
+	if (pos < gap_begin) {
+		std::copy_backward(buffer.begin() + pos, buffer.begin() + gap_begin, buffer.begin() + gap_end);
+		gap_end -= gap_begin - pos;
+		gap_begin = pos;
+	} else if (pos > gap_begin) {
+		size_t n = pos - gap_begin;
+		std::copy(buffer.begin() + gap_end, buffer.begin() + gap_end + n, buffer.begin() + gap_begin);
+		gap_begin += n;
+		gap_end += n;
+	}
+}
+
+void GapBuffer::insert(size_t pos, std::string_view s)
 {
-	size_t line_end = lines[cursor_y].size();
-	if (cursor_x > line_end) cursor_x = line_end;
+	move_gap(std::min(pos, size()));
+	if (gap_end - gap_begin < s.size()) {
+		size_t grow = std::max(s.size(), buffer.size()) + MIN_GAP;
+		buffer.insert(gap_end, grow, '\0');
+		gap_end += grow;
+	}
+	std::copy(s.begin(), s.end(), buffer.begin() + gap_begin);
+	gap_begin += s.size();
 }
 
-void Editor::update_screen_positions(size_t x, size_t y)
+void GapBuffer::erase(size_t pos, size_t length)
 {
-	if (screen_positions[y].size() != lines[y].size())
-		screen_positions[y].resize(lines[y].size());
+	if (pos >= size())
+		return;
+	length = std::min(length, size() - pos);
+	move_gap(pos);
+	gap_end += length;
+}
 
-	size_t screen_x = (x > 0) ? screen_positions[y][x - 1] : 0;
-	while(x < lines[y].size()) {
-		screen_x += (lines[y][x] != '\t') ? 1 : tab_width - screen_x % tab_width;
-		size_t w = sym_width(lines[y][x]);
-		for (size_t j = 0; j < w; ++j)
-			screen_positions[y][x + j] = screen_x;
+std::string GapBuffer::substr(size_t pos, size_t length) const
+{
+	std::string result;
+	if (pos >= size())
+		return result;
 
-		x += w;
+	length = std::min(length, size() - pos);
+	result.reserve(length);
+	size_t end = pos + length;
+	if (pos < gap_begin)
+		result.append(buffer, pos, std::min(end, gap_begin) - pos);
+	if (end > gap_begin) {
+		size_t from = std::max(pos, gap_begin);
+		result.append(buffer, from + gap_end - gap_begin, end - from);
 	}
+	return result;
+}
+
+std::string_view GapBuffer::text()
+{
+	move_gap(size());
+	return before();
+}
+
+char32_t GapBuffer::code_point(size_t& pos) const
+{
+	unsigned char c = (*this)[pos];
+	size_t length = c < 0x80 ? 1 : (c >> 5) == 0x06 ? 2 : (c >> 4) == 0x0E ? 3 : (c >> 3) == 0x1E ? 4 : 0;
+	if (length == 0 || pos + length > size()) {
+		++pos;
+		return c;
+	}
+
+	char32_t result = length == 1 ? c : c & (0x7F >> length);
+	for (size_t i = 1; i < length; ++i) {
+		unsigned char next = (*this)[pos + i];
+		if ((next & 0xC0) != 0x80) {
+			++pos;
+			return c;
+		}
+		result = (result << 6) | (next & 0x3F);
+	}
+	pos += length;
+	return result;
+}
+
+size_t GapBuffer::previous(size_t pos) const
+{
+	if (pos == 0)
+		return 0;
+
+	size_t start = pos - 1;
+	while (start > 0 && pos - start < 4 && (static_cast<unsigned char>((*this)[start]) & 0xC0) == 0x80)
+		--start;
+	// an invalid sequence is passed by octets
+	size_t next = start;
+	code_point(next);
+	return next == pos ? start : pos - 1;
+}
+
+
+size_t advance_column(size_t column, char32_t c, size_t tab_width)
+{
+	if (c == '\t')
+		return column + tab_width - column % tab_width;
+	// ncurses shows the control characters as ^X
+	if (c < 0x20 || c == 0x7F)
+		return column + 2;
+	int width = wcwidth(static_cast<wchar_t>(c));
+	return column + (width >= 0 ? width : 1);
+}
+
+
+size_t Editor::advance(size_t column, char32_t c) const
+{
+	return advance_column(column, c, tab_width);
+}
+
+size_t Editor::column(size_t y, size_t x) const
+{
+	size_t result = 0;
+	for (size_t i = 0; i < x;)
+		result = advance(result, lines[y].code_point(i));
+	return result;
+}
+
+size_t Editor::position(size_t y, size_t column) const
+{
+	size_t x = 0, current = 0;
+	while (x < lines[y].size()) {
+		size_t next = x;
+		size_t after = advance(current, lines[y].code_point(next));
+		if (after > column)
+			break;
+		x = next;
+		current = after;
+	}
+	return x;
+}
+
+// the cursor keeps its display column, as far as the line allows
+void Editor::move_vertically(size_t y)
+{
+	size_t screen_column = get_screen_x();
+	cursor_y = y;
+	cursor_x = position(cursor_y, screen_column);
+	screen_x_valid = false;
 }
 
 Editor::Editor(size_t tab_size)
-	: tab_width(tab_size)
-	, ascii_width(1)
-	, utf8_width(2)
+	: tab_width(std::max<size_t>(tab_size, 1))
+	, lines(1)
 	, cursor_x(0)
 	, cursor_y(0)
+	, screen_x(0)
+	, screen_x_valid(true)
 {
-	lines = std::vector<std::string>(1);
-	screen_positions = std::vector<std::vector<size_t>>(1);
 }
 
 bool Editor::backspace() {
-	bool update_all_screen = false;
 	if (cursor_x != 0) {
-		size_t width = sym_width(lines[cursor_y][cursor_x - 1]);
-		cursor_x -=  width;
-		lines[cursor_y].erase(cursor_x, width);
-	} else { // begin of the line
-		if (cursor_y == 0) return update_all_screen;
-		std::string subst = lines[cursor_y];
-		lines.erase(lines.begin() + cursor_y);
-		screen_positions.erase(screen_positions.begin() + cursor_y);
-		--cursor_y;
-		cursor_x = lines[cursor_y].size();
-		lines[cursor_y].append(subst);
-		update_all_screen = true;
+		size_t start = lines[cursor_y].previous(cursor_x);
+		size_t next = start;
+		char32_t c = lines[cursor_y].code_point(next);
+		lines[cursor_y].erase(start, cursor_x - start);
+		cursor_x = start;
+		// the width of a tab depends on the text before it
+		if (screen_x_valid && c != '\t')
+			screen_x -= advance(0, c);
+		else
+			screen_x_valid = false;
+		return false;
 	}
 
-	update_screen_positions(cursor_x, cursor_y);
-	return update_all_screen;
+	// begin of the line
+	if (cursor_y == 0) return false;
+	std::string subst = lines[cursor_y].str();
+	lines.erase(lines.begin() + cursor_y);
+	--cursor_y;
+	cursor_x = lines[cursor_y].size();
+	lines[cursor_y].insert(cursor_x, subst);
+	screen_x_valid = false;
+	return true;
 }
 
 bool Editor::del() {
-	bool update_all_screen = false;
 	if (cursor_x != lines[cursor_y].size()) {
-		size_t width = sym_width(lines[cursor_y][cursor_x]);
-		lines[cursor_y].erase(cursor_x, width);
-	} else { // end of line
-		if (cursor_y == lines.size() - 1) return update_all_screen;
-		std::string subst = lines[cursor_y + 1];
-		lines.erase(lines.begin() + cursor_y + 1);
-		screen_positions.erase(screen_positions.begin()  + cursor_y + 1);
-		lines[cursor_y].append(subst);
-		update_all_screen = true;
+		size_t next = cursor_x;
+		lines[cursor_y].code_point(next);
+		lines[cursor_y].erase(cursor_x, next - cursor_x);
+		return false;
 	}
 
-	update_screen_positions(cursor_x, cursor_y);
-	return update_all_screen;
+	// end of line
+	if (cursor_y == lines.size() - 1) return false;
+	std::string subst = lines[cursor_y + 1].str();
+	lines.erase(lines.begin() + cursor_y + 1);
+	lines[cursor_y].insert(cursor_x, subst);
+	return true;
 }
 
-void Editor::home() { cursor_x = 0; }
-
-void Editor::end() { cursor_x = lines[cursor_y].size(); }
-
-void Editor::page_up() {
-	cursor_y = 0;
-	put_cursor_inside_line();
+void Editor::home() {
+	cursor_x = 0;
+	screen_x = 0;
+	screen_x_valid = true;
 }
 
-void Editor::page_down() {
-	cursor_y = lines.size() - 1;
-	put_cursor_inside_line();
+void Editor::end() {
+	cursor_x = lines[cursor_y].size();
+	screen_x_valid = false;
 }
 
+void Editor::page_up() { move_vertically(0); }
+
+void Editor::page_down() { move_vertically(lines.size() - 1); }
+
 void Editor::right() {
 	if (cursor_x >= lines[cursor_y].size()) return;
-	cursor_x += sym_width(lines[cursor_y][cursor_x]);
+	char32_t c = lines[cursor_y].code_point(cursor_x);
+	if (screen_x_valid)
+		screen_x = advance(screen_x, c);
 }
 
 void Editor::left() {
 	if (cursor_x == 0) return;
-	cursor_x -= sym_width(lines[cursor_y][cursor_x - 1]);
+	cursor_x = lines[cursor_y].previous(cursor_x);
+	size_t next = cursor_x;
+	char32_t c = lines[cursor_y].code_point(next);
+	if (screen_x_valid && c != '\t')
+		screen_x -= advance(0, c);
+	else
+		screen_x_valid = false;
 }
 
 void Editor::up() {
 	if (cursor_y == 0) return;
-	--cursor_y;
-	put_cursor_inside_line();
+	move_vertically(cursor_y - 1);
 }
 
 void Editor::down() {
 	if (cursor_y == lines.size() - 1) return;
-	++cursor_y;
-	put_cursor_inside_line();
+	move_vertically(cursor_y + 1);
 }
 
 void Editor::new_line() {
-	std::string &&remaining_subst = lines[cursor_y].substr(cursor_x);
-	lines[cursor_y].erase(cursor_x);
-	update_screen_positions(cursor_x, cursor_y);
+	std::string remaining_subst = lines[cursor_y].substr(cursor_x);
+	lines[cursor_y].erase(cursor_x, remaining_subst.size());
 
 	++cursor_y;
-	lines.insert(lines.begin() + cursor_y, remaining_subst);
-	screen_positions.insert(screen_positions.begin() + cursor_y, std::vector<size_t>());
-	cursor_x = 0;
-	update_screen_positions(cursor_x, cursor_y);
+	lines.insert(lines.begin() + cursor_y, GapBuffer(remaining_subst));
+	home();
 }
 
-void Editor::add_ch(char ch) {
-	lines[cursor_y].insert(cursor_x, 1, ch);
-	update_screen_positions(cursor_x, cursor_y);
-	cursor_x += ascii_width;
+void Editor::add_ch(char32_t ch) {
+	char octets[4];
+	size_t length = utils::encode_utf8(octets, ch) - octets;
+	lines[cursor_y].insert(cursor_x, std::string_view(octets, length));
+	cursor_x += length;
+	if (screen_x_valid)
+		screen_x = advance(screen_x, ch);
 }
 
-void Editor::add_ch(char ch_high, char ch_low) {
-	lines[cursor_y].insert(cursor_x, 1, ch_low);
-	lines[cursor_y].insert(cursor_x, 1, ch_high);
-	update_screen_positions(cursor_x, cursor_y);
-	cursor_x += utf8_width;
+bool Editor::add_str(const std::string &s) {
+	size_t begin = 0;
+	for (;;) {
+		size_t end = std::min(s.find('\n', begin), s.size());
+		lines[cursor_y].insert(cursor_x, std::string_view(s).substr(begin, end - begin));
+		cursor_x += end - begin;
+		if (end == s.size())
+			break;
+		new_line();
+		begin = end + 1;
+	}
+	screen_x_valid = false;
+	return s.find('\n') != std::string::npos;
 }
 
-void Editor::add_str(const std::string &s) {
-	lines[cursor_y].insert(cursor_x, s);
-	update_screen_positions(cursor_x, cursor_y);
-	cursor_x += s.length();
-}
+void Editor::replace(size_t y, size_t x, size_t length, const std::string &s) {
+	if (y >= lines.size() || x > lines[y].size())
+		return;
 
-const std::vector<std::string>& Editor::get_lines() { return lines; }
+	length = std::min(length, lines[y].size() - x);
+	lines[y].erase(x, length);
+	lines[y].insert(x, s);
+	if (cursor_y != y)
+		return;
 
-std::list<std::string> Editor::get_lines_list() {
-	std::list<std::string> result;
-	std::copy( lines.begin(), lines.end(), std::back_inserter( result ) );
-	return result;
+	if (cursor_x >= x + length)
+		cursor_x = cursor_x - length + s.length();
+	else if (cursor_x > x)
+		cursor_x = x + s.length();
+	screen_x_valid = false;
 }
 
-const std::string& Editor::get_current_line()
+size_t Editor::get_screen_x()
 {
-	return lines[cursor_y];
+	if (!screen_x_valid) {
+		screen_x = column(cursor_y, cursor_x);
+		screen_x_valid = true;
+	}
+	return screen_x;
 }
 
-size_t Editor::get_screen_x() { return cursor_x > 0 ? screen_positions[cursor_y][cursor_x - 1] : 0; }
 size_t Editor::get_screen_y() { return cursor_y; }
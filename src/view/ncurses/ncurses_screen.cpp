@@ -33,8 +33,9 @@ namespace view {
 
 namespace ncurses {
 
-NScreen::NScreen(bool enter_accept_mode, int tab_size)
+NScreen::NScreen(bool enter_accept_mode, int tab_size, FILE* output)
 	: enter_accept_mode(enter_accept_mode)
+	, output(output)
 {
 	enum CLR_CODE {
 		BLACK = 0,
@@ -53,11 +54,20 @@ NScreen::NScreen(bool enter_accept_mode, int tab_size)
 		DARK_BLACK = 16,
 	};
 
-	initscr();
+	// as initscr does, but to the given output
+	terminal = newterm(nullptr, output, stdin);
+	if (!terminal)
+		throw std::runtime_error("NScreen: can't initialize the terminal");
+	set_term(terminal);
 	set_tabsize(tab_size);
 	start_color();
 	cbreak();
 	noecho();
+	// a paste comes between the marks and is put to the answer at once
+	define_key("\033[200~", KEY_PASTE_BEGIN);
+	define_key("\033[201~", KEY_PASTE_END);
+	fputs("\033[?2004h", output);
+	fflush(output);
 
 #ifdef LIGHT_MODE
 	int bkgr = CLR_CODE::LIGHT_WHITE;
@@ -95,7 +105,7 @@ NScreen::NScreen(bool enter_accept_mode, int tab_size)
 
 	window_statistic.reset(new StatisticWindow());
 	window_question.reset(new QuestionWindow());
-	window_answer.reset(new AnswerWindow(std::bind(&NScreen::resize, this), tab_size));
+	window_answer.reset(new AnswerWindow(loop, std::bind(&NScreen::resize, this), tab_size));
 	window_solution.reset(new SolutionWindow());
 	window_message.reset(new MessageWindow());
 
@@ -116,27 +126,104 @@ void NScreen::resize()
 	window_message->resize({ .x = 0, .y = statistic_h + ques_h + answ_h + resl_h, .w = COLS, .h = message_h });
 
 	window_answer->focus(true);
+	present();
+}
+
+// the windows are staged by their refresh, the frame goes to the terminal at once
+void NScreen::present()
+{
+	// the last one keeps the cursor
+	window_answer->stage();
+	doupdate();
+
+	// a SIGUSR1 interrupts the wait, so the dump is made after its frame
+	if (latency::enabled() && latency::dump_requested())
+		latency::dump();
+}
+
+void NScreen::track(latency::Event event)
+{
+	if (!latency::enabled())
+		return;
+	tracked = event;
+	key_read = latency::Clock::now();
+}
+
+void NScreen::done(latency::Event event)
+{
+	if (tracked != event)
+		return;
+	latency::record(event, key_read);
+	tracked = latency::Event::COUNT;
+}
+
+void NScreen::start_clock()
+{
+	stop_clock();
+	time_over = false;
+	problem_shown = std::chrono::steady_clock::now();
+	window_statistic->set_clock(0, time_limit);
+	clock_timer = loop.add_timer(std::chrono::seconds(1), std::chrono::seconds(1), [this]() { tick(); });
+}
+
+void NScreen::stop_clock()
+{
+	if (clock_timer < 0)
+		return;
+	loop.remove_timer(clock_timer);
+	clock_timer = -1;
+}
+
+// the frame is presented by the waiting one, the loop returns to it after the handler
+void NScreen::tick()
+{
+	auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+		std::chrono::steady_clock::now() - problem_shown).count();
+	window_statistic->set_clock(static_cast<int>(elapsed), time_limit);
+	if (time_limit > 0 && elapsed >= time_limit) {
+		time_over = true;
+		stop_clock();
+	}
 }
 
 NScreen::~NScreen()
 {
+	stop_clock();
+	window_statistic.reset();
+	window_question.reset();
+	window_answer.reset();
+	window_solution.reset();
+	window_message.reset();
+
 	endwin();
+	fputs("\033[?2004l", output);
+	fflush(output);
+	delscreen(terminal);
+	latency::dump();
 }
 
 void NScreen::update_statistic(const Statistics &s)
 {
 	window_statistic->update(s);
+	present();
 }
 
 void NScreen::show_problem(const Problem& problem)
 {
-	current_problem = problem;
 	window_solution->update(problem);
 	window_solution->visibility(false);
 	window_question->update(problem);
 	window_answer->prepare();
 	window_answer->focus(true);
 	window_message->update("F2 - check answer       F3 - skip question       F12 - exit ");
+	start_clock();
+	present();
+	done(latency::Event::TRANSITION);
+}
+
+void NScreen::set_live_check(const LiveCheck& check)
+{
+	window_answer->set_live_check(check);
 }
 
 void NScreen::set_language(utils::Language language)
@@ -144,19 +231,38 @@ void NScreen::set_language(utils::Language language)
 	window_message->set_lan(language);
 }
 
-std::tuple<Screen::INPUT_STATE, std::list<std::string>> NScreen::get_answer()
+Screen::INPUT_STATE NScreen::get_answer(analysis::AnswerLines& answer)
 {
+	answer.clear();
 	for (;;) {
-		int key = window_answer->get_key();
-
-		if (key == KEY_F(2) || (enter_accept_mode && key == '\n'))
-			return std::make_tuple(Screen::INPUT_STATE::ENTERED, window_answer->get_lines());
-		else if (key == KEY_F(3))
-			return std::make_tuple(Screen::INPUT_STATE::SKIPPED, std::list<std::string>());
-		else if (key == KEY_F(12))
-			return std::make_tuple(Screen::INPUT_STATE::EXIT, std::list<std::string>());
-		else
+		// the capture wakes the loop by every hypothesis of the phrase
+		std::string error = window_answer->poll_capture();
+		if (!error.empty())
+			window_message->update(error);
+		present();
+		done(latency::Event::KEY);
+		if (time_over) {
+			window_answer->get_lines(answer);
+			return Screen::INPUT_STATE::ENTERED;
+		}
+		Key key = window_answer->get_key();
+		if (key.none())
+			continue;
+
+		if (key.is(KEY_F(2)) || (enter_accept_mode && (key.is_char('\n') || key.is(KEY_ENTER)))) {
+			track(latency::Event::SUBMIT);
+			window_answer->get_lines(answer);
+			return Screen::INPUT_STATE::ENTERED;
+		} else if (key.is(KEY_SPREVIOUS) || key.is(KEY_SNEXT))
+			window_question->page(key.is(KEY_SPREVIOUS) ? -1 : 1);
+		else if (key.is(KEY_F(3)))
+			return Screen::INPUT_STATE::SKIPPED;
+		else if (key.is(KEY_F(12)))
+			return Screen::INPUT_STATE::EXIT;
+		else {
+			track(latency::Event::KEY);
 			window_answer->key_process(key);
+		}
 	}
 
 	window_message->set_lan(utils::Language::UNKNOWN);
@@ -165,25 +271,56 @@ std::tuple<Screen::INPUT_STATE, std::list<std::string>> NScreen::get_answer()
 int NScreen::wait_pressed_key()
 {
 	window_answer->focus(true, false);
-	int key = window_answer->get_key();
-	if (key == KEY_F(3)) return FKEY::F3;
-	return key;
+	for (;;) {
+		present();
+		Key key = window_answer->get_key();
+		if (key.none())
+			continue;
+		// the long question, solution and checked answer are scrolled, the other keys are returned
+		if (key.is(KEY_SPREVIOUS) || key.is(KEY_SNEXT))
+			window_question->page(key.is(KEY_SPREVIOUS) ? -1 : 1);
+		else if (key.is(KEY_PPAGE) || key.is(KEY_NPAGE))
+			window_solution->page(key.is(KEY_PPAGE) ? -1 : 1);
+		else if (key.is(KEY_UP) || key.is(KEY_DOWN))
+			window_answer->scroll_by(key.is(KEY_UP) ? -1 : 1);
+		else {
+			// the key after the result leads to the next problem, mostly
+			track(latency::Event::TRANSITION);
+			if (key.is(KEY_F(3)))
+				return FKEY::F3;
+			else if (key.type == Key::Type::TEXT)
+				return static_cast<int>(utils::to_utf32(key.text).front());
+			else
+				return static_cast<int>(key.code);
+		}
+	}
 }
 
-void NScreen::show_result(const analysis::Verification& v)
+void NScreen::show_result(const std::shared_ptr<const analysis::Verification>& v)
 {
+	stop_clock();
 	window_solution->visibility(true);
 	window_answer->show_analysed(v);
+	present();
+	done(latency::Event::SUBMIT);
 }
 
 void NScreen::show_solution()
 {
+	stop_clock();
 	window_solution->visibility(true);
+	present();
 }
 
 void NScreen::show_message(const std::string& msg)
 {
 	window_message->update(msg);
+	present();
+}
+
+void NScreen::set_time_limit(int seconds)
+{
+	time_limit = seconds;
 }
 
 } // namespace ncurses
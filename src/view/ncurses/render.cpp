@@ -0,0 +1,123 @@
+/*
+ * render.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *  Copyright © 2018-2081 Ilja Karasev <ilja.karasev@gmail.com>.
+ *  All rights reserved.
+ *     License: GNU GPL 3
+ */
+
+#include <algorithm>
+
+#include <render.h>
+
+namespace view {
+
+namespace ncurses {
+
+void Frame::reset(int height, int width)
+{
+	columns = width;
+	next.assign(std::max(height, 0), Line());
+	last.assign(next.size(), Line());
+	drawn.assign(next.size(), false);
+	reached.assign(next.size(), -1);
+	cursor_y = cursor_x = 0;
+	moved = false;
+}
+
+void Frame::clear()
+{
+	for (Line& line: next)
+		line.clear();
+	cursor_y = cursor_x = 0;
+	moved = true;
+}
+
+void Frame::clear_line(int y)
+{
+	if (y >= 0 && y < height())
+		next[y].clear();
+}
+
+void Frame::move(int y, int x)
+{
+	cursor_y = y;
+	cursor_x = x;
+	moved = true;
+}
+
+void Frame::add(std::string_view text, int color, bool bold)
+{
+	if (cursor_y < 0 || cursor_y >= height())
+		return;
+
+	next[cursor_y].push_back({ moved ? cursor_x : -1, std::string(text), color, bold });
+	moved = false;
+}
+
+size_t Frame::commit(WINDOW* window)
+{
+	size_t redrawn = 0;
+	// a line longer than the window wraps to the next lines, as the full redraw does,
+	// so the lines it reaches now or has reached before are redrawn too
+	int forced_until = -1, overflow_until = -1;
+	for (int y = 0; y < height(); ++y) {
+		if (y > forced_until && drawn[y] && next[y] == last[y])
+			continue;
+
+		wmove(window, y, 0);
+		if (y > overflow_until)
+			wclrtoeol(window);
+		for (const Span& s: next[y]) {
+			if (s.x >= 0)
+				wmove(window, y, s.x);
+			wattrset(window, (s.color != 0 ? COLOR_PAIR(s.color) : 0) | (s.bold ? A_BOLD : 0));
+			waddstr(window, s.text.c_str());
+		}
+		wattrset(window, A_NORMAL);
+
+		int end_y = getcury(window);
+		if (end_y > y) {
+			wclrtoeol(window);
+			overflow_until = end_y;
+		}
+		forced_until = std::max({ forced_until, end_y, reached[y] });
+		reached[y] = end_y;
+
+		last[y] = next[y];
+		drawn[y] = true;
+		++redrawn;
+	}
+	return redrawn;
+}
+
+void Viewport::set_rows(size_t r)
+{
+	rows = r;
+	set_lines(lines);
+}
+
+void Viewport::set_lines(size_t l)
+{
+	lines = l;
+	offset = std::min(offset, lines > rows ? lines - rows : 0);
+}
+
+void Viewport::scroll_by(long n)
+{
+	offset = n < 0 ? offset - std::min(offset, static_cast<size_t>(-n)) : offset + n;
+	set_lines(lines);
+}
+
+void Viewport::show(size_t line)
+{
+	if (line < offset)
+		offset = line;
+	else if (rows > 0 && line >= offset + rows)
+		offset = line - rows + 1;
+}
+
+} // namespace ncurses
+
+} // namespace view
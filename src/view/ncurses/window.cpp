@@ -10,7 +10,9 @@
 #include <window.h>
 #include <utils.h>
 #include <analyzer.h>
+#include <chrono>
 #include <cstring>
+#include <unistd.h>
 
 #define LIGHT_MODE 1
 
@@ -20,6 +22,21 @@ namespace ncurses {
 
 #define SERVICE_COLOR YELLOW
 
+namespace {
+
+// the terminal sends a paste at once, the end mark is not waited for longer
+const int PASTE_TIMEOUT_MS = 500;
+// a drag of the terminal edge sends a series of resizes, the layout is done after the last one
+const int RESIZE_SETTLE_MS = 30;
+
+// the typed text, not the editing keys
+bool printable(const Key& key)
+{
+	return key.type == Key::Type::CHARACTER && (key.code >= 0x20 || key.code == '\t') && key.code != 0x7F;
+}
+
+} // namespace
+
 void Window::create()
 {
 	window = newwin(geometry.h, geometry.w, geometry.y, geometry.x);
@@ -39,35 +56,54 @@ void Window::remove()
 	window = NULL;
 }
 
+// starts a new frame, the unchanged lines are not redrawn;
+// the separator shows the visible lines of a long content
 void Window::clear()
 {
-	wclear(window);
+	frame.clear();
 	if (geometry.h > 1) {
-		wmove(window, geometry.h - 1, 0);
-		whline(window, '-', geometry.w);
+		std::string separator(geometry.w, '-');
+		if (view.clipped()) {
+			std::string lines = " " + std::to_string(view.begin() + 1) + "-" + std::to_string(view.end())
+				+ "/" + std::to_string(view.size()) + " ";
+			if (lines.size() + 2 < separator.size())
+				separator.replace(separator.size() - lines.size() - 2, lines.size(), lines);
+		}
+		frame.add_line(geometry.h - 1, 0, separator);
 	}
-	wmove(window, 0, 0);
+	frame.move(0, 0);
 }
 
 void Window::waddstr_colored(const std::string &s, int color_scheme, bool bold)
 {
-	if (bold) wattron(window, A_BOLD);
-	wattron(window, COLOR_PAIR(color_scheme));
-	waddstr(window, s.c_str());
-	wattroff(window, COLOR_PAIR(color_scheme));
-	if (bold) wattroff(window, A_BOLD);
+	frame.add(s, color_scheme, bold);
+}
+
+// the window is sent to the terminal by the next doupdate, with the others
+void Window::stage()
+{
+	frame.commit(window);
+	wnoutrefresh(window);
 }
 
 void Window::refresh()
 {
-	wrefresh(window);
+	stage();
 }
 
+// the window is resized in place, it keeps its keypad, timeout and background;
+// the content is drawn again from the model
 void Window::resize(const Geometry g)
 {
-	remove();
 	geometry = g;
-	create();
+	if (!window) {
+		create();
+	} else {
+		wresize(window, geometry.h, geometry.w);
+		mvwin(window, geometry.y, geometry.x);
+	}
+	frame.reset(geometry.h, geometry.w);
+	view.set_rows(std::max(geometry.h > 1 ? geometry.h - 1 : geometry.h, 0));
 	refresh();
 }
 
@@ -75,175 +111,314 @@ void StatisticWindow::refresh()
 {
 	clear();
 
-	wmove(window, 0, 1);
+	frame.move(0, 1);
 	waddstr_colored("Left:[" + std::to_string(statistics.left_problems) + "];", GREEN);
 	waddstr_colored(" Solved:[" + std::to_string(statistics.solved_problems) + "];", CYAN);
 	waddstr_colored(" Errors:[" + std::to_string(statistics.errors) + "]", RED);
 
+	// the clock is on the separator, the row above is full in a narrow terminal
+	if (elapsed >= 0 && geometry.h > 1) {
+		auto clock = [](int seconds) {
+			std::string s = std::to_string(seconds % 60);
+			return std::to_string(seconds / 60) + (s.size() == 1 ? ":0" : ":") + s;
+		};
+		frame.move(geometry.h - 1, 1);
+		waddstr_colored(" Time:[" + clock(elapsed) + (limit > 0 ? "/" + clock(limit) : "") + "] ",
+			limit > 0 && limit - elapsed <= 5 ? RED : GRAY);
+	}
+
 	const std::string &problem = "PROBLEM:";
 	const std::string &repeat = " Repeat:[" + std::to_string(statistics.problem_repeat_times) + "];";
 	const std::string &errors = " Errors:[" + std::to_string(statistics.problem_errors) + "];";
 	const std::string &total_errors = " Total errors:[" + std::to_string(statistics.problem_total_errors) + "]";
-	wmove(window, 0, geometry.w - (problem + repeat + errors + total_errors).size() - 1);
+	frame.move(0, geometry.w - (problem + repeat + errors + total_errors).size() - 1);
 
-	waddstr(window, problem.c_str());
+	frame.add(problem);
 	waddstr_colored(repeat, YELLOW);
 	waddstr_colored(errors, BLUE);
 	waddstr_colored(total_errors, MAGENTA);
 
-	wrefresh(window);
+	stage();
 }
 
-void QuestionWindow::refresh()
+// the visible lines of the shared content, from the top line of the viewport
+static
+void add_lines(Frame& frame, const Viewport& view, const SharedLines& lines)
 {
-	clear();
+	if (!lines)
+		return;
 
-	int y = 0;
-	for (const std::string& s: question)
-		mvwaddstr(window, y++, 0, s.c_str());
+	for (size_t i = view.begin(); i < view.end(); ++i)
+		frame.add_line(static_cast<int>(i - view.begin()), 0, (*lines)[i]);
+}
 
-	wrefresh(window);
+void QuestionWindow::refresh()
+{
+	view.set_lines(question ? question->size() : 0);
+	clear();
+	add_lines(frame, view, question);
+	stage();
 }
 
 void SolutionWindow::refresh()
 {
+	view.set_lines(visible && solution ? solution->size() : 0);
 	clear();
-	if (visible) {
-		int y = 0;
-		for (const std::string& s: solution)
-			mvwaddstr(window, y++, 0, s.c_str());
-	}
-
-	wrefresh(window);
+	add_lines(frame, view, solution);
+	stage();
 }
 
 void MessageWindow::refresh()
 {
 	clear();
-	wmove(window, 0, 1);
+	frame.move(0, 1);
 	waddstr_colored(message, SERVICE_COLOR);
 
 	std::string lan = lang_to_str();
-	wmove(window, 0, geometry.w - lan.size() - 1);
+	frame.move(0, geometry.w - lan.size() - 1);
 	waddstr_colored(lan, SERVICE_COLOR);
-	wrefresh(window);
+	stage();
 }
 
+// screen column of every code point, the same as the cursor of the editor
 static
-std::vector<int> expand_tabs(const std::string& s, int tab_width)
+std::vector<int> screen_columns(std::string_view s, int tab_width)
 {
-	int pos = 0;
-	std::vector<int> result = { pos };
-	for (char c: s) {
-		pos += (c != '\t') ? 1 : (tab_width - pos % tab_width);
-		result.push_back(pos);
+	size_t column = 0;
+	std::vector<int> result = { 0 };
+	for (size_t pos = 0; pos < s.size();) {
+		column = advance_column(column, utils::next_code_point(s, pos), tab_width);
+		result.push_back(static_cast<int>(column));
 	}
 
 	return result;
 }
 
-void AnswerWindow::update_window()
+// errors of the other lines are skipped
+template <typename Errors>
+void AnswerWindow::draw_errors(size_t y, int row, std::string_view line, const Errors& errors)
 {
-	clear();
-	const std::vector<std::string>& answer = editor->get_lines();
+	std::vector<int> screen_x;
+	for (const analysis::Error& e: errors) {
+		if (e.line != y)
+			continue;
+
+		if (screen_x.empty())
+			screen_x = screen_columns(line, tab_size);
+
+		frame.move(row, screen_x[e.pos]);
+		std::string text(e.text(line));
+		if (e.what == analysis::Error::ERROR_TOKEN)
+			waddstr_colored(text, ERROR_WHITE, false);
+		else if (e.what == analysis::Error::ERROR_SYMBOL)
+			waddstr_colored(text, ERROR_BLACK, true);
+		else if (e.what == analysis::Error::MISSED || e.what == analysis::Error::REDUNDANT)
+			waddstr_colored(text, MISSED_BLACK, true);
+		else if (e.what == analysis::Error::NEAR_MISS)
+			waddstr_colored(text, MISSED_BLACK, false);
+	}
+}
 
-	size_t y = 0;
-	if (mode == Mode::INPUT) {
-		for (const std::string& s: answer)
-			mvwaddstr(window, y++, 0, s.c_str());
-	} else if (mode == Mode::OUTPUT) {
-		static auto mvwaddstr_colored = [&](int y, int x, std::string str, int color, bool bold = false) {
-			wmove(window, y, x);
-			return waddstr_colored(str, color, bold);
-		};
+Key CursorWindow::read_key(int timeout)
+{
+	for (;;) {
+		// the keys already read by ncurses or pushed back are taken first,
+		// otherwise the input is waited for with the timers and the completions
+		wint_t code;
+		wtimeout(window, 0);
+		int result = wget_wch(window, &code);
+		if (result == ERR) {
+			if (loop.wait(STDIN_FILENO, timeout) != tasks::EventLoop::Wake::READABLE)
+				return Key();
+			wtimeout(window, -1);
+			result = wget_wch(window, &code);
+			if (result == ERR)
+				throw std::runtime_error("CursorWindow: wget_wch error");
+		}
+		if (result == KEY_CODE_YES && code == KEY_RESIZE) {
+			wtimeout(window, RESIZE_SETTLE_MS);
+			while ((result = wget_wch(window, &code)) == KEY_CODE_YES && code == KEY_RESIZE)
+				;
+			if (result == KEY_CODE_YES)
+				ungetch(code);
+			else if (result != ERR)
+				unget_wch(code);
+			resize_handle();
+		} else
+			return { result == KEY_CODE_YES ? Key::Type::FUNCTION : Key::Type::CHARACTER, code };
+	}
+}
 
-		for (const std::string& line: verification.answer) {
-			mvwaddstr(window, y, 0, line.c_str());
-			const auto errors_map_it = verification.errors.find(y);
-			if (errors_map_it != verification.errors.end()) {
-				std::vector<int> screen_x = expand_tabs(line, tab_size);
-				for (auto e: errors_map_it->second) {
-					if (e.what == analysis::Error::ERROR_TOKEN) {
-						//mvwaddstr_colored(y, screen_x[e.pos], utils::to_utf8(e.str), ERROR_WHITE, false);
-						wmove(window, y, screen_x[e.pos]);
-						std::string str = utils::to_utf8(e.str);
-						return waddstr_colored(str, ERROR_WHITE, false);
-					}
-					if (e.what == analysis::Error::ERROR_SYMBOL) {
-//						mvwaddstr_colored(y, screen_x[e.pos], utils::to_utf8(e.str), ERROR_BLACK, true);
-						wmove(window, y, screen_x[e.pos]);
-						std::string str = utils::to_utf8(e.str);
-						return waddstr_colored(str, ERROR_BLACK, true);
-					}
-					if (e.what == analysis::Error::MISSED || e.what == analysis::Error::REDUNDANT) {
-//						mvwaddstr_colored(y, screen_x[e.pos], utils::to_utf8(e.str), MISSED_BLACK, true);
-						wmove(window, y, screen_x[e.pos]);
-						std::string str = utils::to_utf8(e.str);
-						return waddstr_colored(str, MISSED_BLACK, true);
-					}
-				}
-			}
-			++y;
+Key CursorWindow::get_key(int timeout)
+{
+	Key key = read_key(timeout);
+	Key text = { Key::Type::TEXT, 0 };
+
+	if (key.is(KEY_PASTE_BEGIN)) {
+		// the new lines of a paste are kept, the editing keys are not expected in it;
+		// a tick of a timer doesn't break the paste
+		using Clock = std::chrono::steady_clock;
+		const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(PASTE_TIMEOUT_MS);
+		for (;;) {
+			auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+			Key k = read_key(std::max<int>(static_cast<int>(left), 0));
+			if (k.is(KEY_PASTE_END) || (k.none() && left <= 0))
+				break;
+			if (k.type == Key::Type::CHARACTER)
+				utils::append_utf8(text.text, k.code == '\r' ? '\n' : k.code);
 		}
+		// an empty or timed out paste is no key, a TEXT key has a symbol at least
+		return text.text.empty() ? Key() : text;
+	}
+	if (!printable(key))
+		return key;
+
+	// a terminal without the bracketed paste sends the paste as a burst of characters,
+	// they are taken at once up to the first key, which is left for the next call
+	utils::append_utf8(text.text, key.code);
+	size_t count = 1;
+	for (Key next = read_key(0); !next.none(); next = read_key(0), ++count) {
+		if (!printable(next)) {
+			if (next.type == Key::Type::FUNCTION)
+				ungetch(next.code);
+			else
+				unget_wch(next.code);
+			break;
+		}
+		utils::append_utf8(text.text, next.code);
+	}
+	return count == 1 ? key : text;
+}
+
+void AnswerWindow::update_window()
+{
+	int row = 0;
+	if (mode == Mode::INPUT) {
+		view.set_lines(editor->get_lines_count());
+		view.show(editor->get_screen_y());
+		clear();
+
+		// the empty lines above the view shift the solution lines of the visible ones
+		if (live_check)
+			for (size_t y = 0; y < view.begin(); ++y)
+				live_check(y, editor->get_text(y));
 
-		++y;
-		if (verification.state == analysis::MARK::RIGHT) {
-//			mvwaddstr_colored(y, 0, "[right]", SERVICE_COLOR);
-			wmove(window, y, 0);
-			return waddstr_colored("[right]", SERVICE_COLOR, false);
+		for (size_t y = view.begin(); y < view.end(); ++y, ++row)
+			draw_line(y, row);
+	} else if (mode == Mode::OUTPUT) {
+		const analysis::Verification& verification = *this->verification;
+		std::vector<const char*> marks;
+		if (verification.right()) {
+			marks.push_back("[right]");
+			if ((verification.state & analysis::MARK::NEAR_MISS) != 0)
+				marks.push_back("[near miss]");
 		} else {
-			if ((verification.state & analysis::MARK::INVALID_LINES_NUMBER) != 0) {
-//				mvwaddstr_colored(y++, 0, "[invalid lines amount]", SERVICE_COLOR);
-				wmove(window, y++, 0);
-				waddstr_colored("[invalid lines amount]", SERVICE_COLOR, false);
-			}
-			if ((verification.state & analysis::MARK::ERROR) != 0) {
-//				mvwaddstr_colored(y++, 0, "[invalid answer]", SERVICE_COLOR);
-				wmove(window, y++, 0);
-				waddstr_colored("[invalid answer]", SERVICE_COLOR, false);
-			}
-			if ((verification.state & analysis::MARK::NOT_FULL_ANSWER) != 0) {
-//				mvwaddstr_colored(y++, 0, "[not full answer]", SERVICE_COLOR);
-				wmove(window, y++, 0);
-				waddstr_colored("[not full answer]", SERVICE_COLOR, false);
-			}
-			if ((verification.state & analysis::MARK::REDUNDANT_ANSWER) != 0) {
-//				mvwaddstr_colored(y++, 0, "[redundant answer]", SERVICE_COLOR);
-				wmove(window, y++, 0);
-				waddstr_colored("[redundant answer]", SERVICE_COLOR, false);
+			if ((verification.state & analysis::MARK::INVALID_LINES_NUMBER) != 0)
+				marks.push_back("[invalid lines amount]");
+			if ((verification.state & analysis::MARK::ERROR) != 0)
+				marks.push_back("[invalid answer]");
+			if ((verification.state & analysis::MARK::NOT_FULL_ANSWER) != 0)
+				marks.push_back("[not full answer]");
+			if ((verification.state & analysis::MARK::REDUNDANT_ANSWER) != 0)
+				marks.push_back("[redundant answer]");
+		}
+
+		// the answer, an empty line and the marks
+		const size_t answer_size = verification.answer.size();
+		view.set_lines(answer_size + 1 + marks.size());
+		clear();
+
+		for (size_t y = view.begin(); y < view.end(); ++y, ++row) {
+			if (y < answer_size) {
+				const std::pmr::string& line = verification.answer[y];
+				frame.add_line(row, 0, line);
+				draw_errors(y, row, line, verification.errors);
+			} else if (y > answer_size) {
+				frame.move(row, 0);
+				waddstr_colored(marks[y - answer_size - 1], SERVICE_COLOR, false);
 			}
 		}
+	} else
+		clear();
+}
 
+void AnswerWindow::update_line()
+{
+	size_t y = editor->get_screen_y();
+	if (!view.visible(y)) {
+		update_window();
+		return;
 	}
+
+	int row = static_cast<int>(y - view.begin());
+	frame.clear_line(row);
+	draw_line(y, row);
 }
 
-void AnswerWindow::update_line()
+// the line is drawn from the both sides of its gap, the checked one is put in one piece
+void AnswerWindow::draw_line(size_t y, int row)
 {
-	wmove(window, editor->get_screen_y(), 0);
-	wclrtoeol(window);
-	waddstr(window, editor->get_current_line().c_str());
+	if (live_check) {
+		std::string_view line = editor->get_text(y);
+		frame.add_line(row, 0, line);
+		draw_errors(y, row, line, live_check(y, line));
+		return;
+	}
+
+	const GapBuffer& line = editor->get_line(y);
+	frame.add_line(row, 0, line.before());
+	frame.add(line.after());
+}
+
+void AnswerWindow::update_edited(bool was_empty)
+{
+	// a line getting empty, or not, shifts the solution lines of the lines after it
+	if (live_check && was_empty != editor->get_current_line().empty())
+		update_window();
+	else
+		update_line();
+}
+
+void AnswerWindow::place_cursor()
+{
+	size_t y = editor->get_screen_y();
+	if (mode == Mode::INPUT && !view.visible(y))
+		update_window();
+	update_cursor({ editor->get_screen_x(), y >= view.begin() ? y - view.begin() : 0 });
 }
 
 void AnswerWindow::refresh()
 {
 	update_window();
-	update_cursor({ editor->get_screen_x(), editor->get_screen_y() });
-	wmove(window, editor->get_screen_y(), editor->get_screen_x());
-	wrefresh(window);
+	place_cursor();
+	stage();
 }
 
 #define ctrl(x)  ((x) & 0x1f)
 
-void AnswerWindow::key_process(int key)
+void AnswerWindow::key_process(const Key& key)
 {
-	switch (key) {
+	const bool was_empty = editor->get_current_line().empty();
+	if (key.type == Key::Type::TEXT) {
+		// a paste is put to the editor and drawn at once
+		editor->add_str(key.text) ? update_window() : update_edited(was_empty);
+	} else if (key.type == Key::Type::CHARACTER) {
 		// some terminals have a problem with the backspace key - it is interpreted as Ctrl-H (0x08)
-		case ctrl('H'):
+		if (key.code == ctrl('H')) {
+			editor->backspace() ? update_window() : update_edited(was_empty);
+		} else if (key.code == '\n') {
+			editor->new_line();
+			update_window();
+		} else {
+			editor->add_ch(key.code);
+			update_edited(was_empty);
+		}
+	} else switch (key.code) {
 		case KEY_BACKSPACE:
-			editor->backspace() ? update_window() : update_line();
+			editor->backspace() ? update_window() : update_edited(was_empty);
 			break;
 		case KEY_DC:
-			editor->del() ? update_window() : update_line();
+			editor->del() ? update_window() : update_edited(was_empty);
 			break;
 		case KEY_HOME:
 			editor->home();
@@ -269,24 +444,20 @@ void AnswerWindow::key_process(int key)
 		case KEY_DOWN:
 			editor->down();
 			break;
-		case '\n':
+		case KEY_ENTER:
 			editor->new_line();
 			update_window();
 			break;
 		case KEY_F(6):
-			editor->add_str(AudioRecord::capture());
-			update_line();
-			break;
-		default:
-			if (key > KEY_CODE_YES)
-				break;
-			if (key < 0x80) { // one-byte octet
-				editor->add_ch(key);
-			} else {          // two-bytes octet
-				int ch_low = wgetch(window);
-				editor->add_ch(key, ch_low);
+			// the input goes on while the phrase is recognized
+			if (!transcript) {
+				// the loop is woken by every hypothesis, an empty handler is enough
+				transcript = AudioRecord::capture_async([&loop = loop]() { loop.post(nullptr); });
+				transcript_x = editor->get_cursor_x();
+				transcript_y = editor->get_screen_y();
+				transcript_length = 0;
 			}
-			update_line();
+			break;
 	}
 
 /* to log
@@ -297,26 +468,62 @@ void AnswerWindow::key_process(int key)
 			dbg_message(ss.str());
 #endif
 */
-	wmove(window, editor->get_screen_y(), editor->get_screen_x());
-	wrefresh(window);
-	update_cursor({ editor->get_screen_x(), editor->get_screen_y() });
+	place_cursor();
+	stage();
+}
+
+std::string AnswerWindow::poll_capture()
+{
+	std::string hypothesis, error;
+	bool final = false;
+	if (!transcript || !transcript->take(hypothesis, final, error))
+		return error;
+
+	// the previous hypothesis is replaced, the typed text is kept
+	editor->replace(transcript_y, transcript_x, transcript_length, hypothesis);
+	transcript_length = hypothesis.size();
+	if (final) {
+		transcript->set_listener(nullptr);
+		transcript.reset();
+	}
+
+	update_window();
+	place_cursor();
+	stage();
+	return error;
+}
+
+AnswerWindow::~AnswerWindow()
+{
+	// the capture may outlive the loop, it's stopped
+	if (transcript)
+		transcript->cancel();
 }
 
 void AnswerWindow::prepare() {
 	mode = Mode::INPUT;
+	// the phrase of the previous problem is dropped, the microphone is released
+	if (transcript)
+		transcript->cancel();
+	transcript.reset();
+	verification.reset();
 	editor.reset(new Editor(tab_size));
+	view.top();
 	refresh();
 }
 
-void AnswerWindow::show_analysed(const analysis::Verification& v) {
+void AnswerWindow::show_analysed(const std::shared_ptr<const analysis::Verification>& v) {
 	mode = Mode::OUTPUT;
 	verification = v;
+	view.top();
 	refresh();
 }
 
-std::list<std::string> AnswerWindow::get_lines()
+void AnswerWindow::get_lines(analysis::AnswerLines& lines)
 {
-	return editor->get_lines_list();
+	lines.clear();
+	for (size_t y = 0; y < editor->get_lines_count(); ++y)
+		lines.push_back(editor->get_text(y));
 }
 
 } // namespace ncurses
@@ -1,134 +1,285 @@
 #include <voice.h>
 #include <analyzer.h>
+#include <executor.h>
+#include <speech.h>
 #include <utils.h>
 #include <log.h>
-#include <thread>
-#include <functional>
 
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unistd.h>
+
+#ifdef AUDIO_CAPTURE
+#include <recognizer.h>
+
+namespace {
+
+// a phrase is not longer, the partial hypothesis is taken after it
+const std::chrono::seconds CAPTURE_TIMEOUT(15);
+
+struct Capture
+{
+	audio::Recognizer recognizer;
+	audio::Microphone microphone;
+
+	Capture() : microphone(recognizer.sample_rate()) {}
+};
+
+// loaded by the first call in the background, the audio device is kept open
+std::shared_future<std::shared_ptr<Capture>>& capture_device()
+{
+	static std::shared_future<std::shared_ptr<Capture>> loaded = []() {
+		auto promise = std::make_shared<std::promise<std::shared_ptr<Capture>>>();
+		std::shared_future<std::shared_ptr<Capture>> future = promise->get_future().share();
+		tasks::Executor::shared().submit(tasks::Priority::NORMAL, [promise](const tasks::Token&) {
+			try {
+				promise->set_value(std::make_shared<Capture>());
+			} catch (...) {
+				promise->set_exception(std::current_exception());
+			}
+		});
+		return future;
+	}();
+	return loaded;
+}
+
+} // namespace
+#endif
+
+void AudioRecord::Transcript::update(const std::string& text, bool final)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	hypothesis = text;
+	finished = final;
+	changed = true;
+	if (listener)
+		listener();
+}
+
+void AudioRecord::Transcript::fail(const std::string& error)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	failure = error;
+	finished = true;
+	changed = true;
+	if (listener)
+		listener();
+}
+
+bool AudioRecord::Transcript::take(std::string& text, bool& final, std::string& error)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!changed)
+		return false;
+
+	text = hypothesis;
+	final = finished;
+	error = failure;
+	changed = false;
+	return true;
+}
+
+void AudioRecord::Transcript::set_listener(const std::function<void()>& l)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	listener = l;
+}
+
+void AudioRecord::Transcript::cancel()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	listener = nullptr;
+	token.cancel();
+}
+
+void AudioRecord::prepare_capture()
+{
 #ifdef AUDIO_CAPTURE
-#include <pocketsphinx/pocketsphinx.h>
-#include <sphinxbase/ad.h>
-#include <sphinxbase/err.h>
-#include <sphinxbase/cmd_ln.h>
-#include <cstdio>
-#include <cstring>
-
-#define SIZE 32000
-
-static const char *hmm_verbose = "/usr/share/sphinx-voxforge-en/hmm/voxforge_en_sphinx.cd_cont_3000";
-static const char *lm_verbose = "/usr/share/sphinx-voxforge-en/lm/voxforge_en_sphinx.cd_cont_3000/voxforge_en_sphinx.lm.DMP";
-static const char *dict_verbose = "/usr/share/sphinx-voxforge-en/lm/voxforge_en_sphinx.cd_cont_3000/voxforge_en_sphinx.dic";
-
-//static const char *hmm_default = "/usr/share/pocketsphinx/model/hmm/en_US/hub4wsj_sc_8k";
-//static const char *lm_default = "/usr/share/pocketsphinx/model/lm/en_US/hub4.5000.DMP";
-//static const char *dict_default = "/usr/share/pocketsphinx/model/lm/en_US/cmu07a.dic";
+	capture_device();
 #endif
+}
 
-std::string AudioRecord::capture()
+std::string AudioRecord::capture(Transcript* transcript, const tasks::Token& token)
 {
+	std::string result;
 #ifdef AUDIO_CAPTURE
-	ps_decoder_t *ps;                  // create pocketsphinx decoder structure
-	cmd_ln_t *config;                  // create configuration structure
-	ad_rec_t *ad;                      // create audio recording structure - for use with ALSA functions
-
-	int16 adbuf[SIZE];                 // buffer array to hold audio data
-	uint8 utt_started, in_speech;      // flags for tracking active speech - has speech started? - is speech currently happening?
-	int32 k;                           // holds the number of frames in the audio buffer
-	char const *decoded_speech;
-
-	config = cmd_ln_init(NULL, ps_args(), TRUE,                   // Load the configuration structure - ps_args() passes the default values
-	"-hmm", hmm_verbose,   // path to the standard english language model
-	"-lm", lm_verbose,     // custom language model (file must be present)
-	"-dict", dict_verbose, // custom dictionary (file must be present)
-	"-logfn", "/dev/null", // suppress log info from being sent to screen
-	NULL);
-
-	ps = ps_init(config);                                                        // initialize the pocketsphinx decoder
-	ad = ad_open_dev(cmd_ln_str_r(config, "-adcdev"), (int) cmd_ln_float32_r(config, "-samprate")); // open default microphone at default samplerate
-
-	ad_start_rec(ad);    // start recording
-	ps_start_utt(ps);    // mark the start of the utterance
-	utt_started = FALSE; // clear the utt_started flag
-
-	while(1) {
-		k = ad_read(ad, adbuf, 4096);                // capture the number of frames in the audio buffer
-		ps_process_raw(ps, adbuf, k, FALSE, FALSE);  // send the audio buffer to the pocketsphinx decoder
-
-		in_speech = ps_get_in_speech(ps);            // test to see if speech is being detected
-
-		if (in_speech && !utt_started)            // if speech has started and utt_started flag is false
-			utt_started = TRUE;                   // then set the flag
-
-		if (!in_speech && utt_started) {             // if speech has ended and the utt_started flag is true
-			ps_end_utt(ps);                          // then mark the end of the utterance
-			ad_stop_rec(ad);                         // stop recording
-			decoded_speech = ps_get_hyp(ps, NULL);             // query pocketsphinx for "hypothesis" of decoded statement
-			break;                                   // exit the while loop and return to main
-		}
+	// the terminal belongs to the UI, the errors are not written to it
+	try {
+		std::shared_ptr<Capture> device = capture_device().get();
+		auto deadline = std::chrono::steady_clock::now() + CAPTURE_TIMEOUT;
+		result = device->recognizer.recognize(device->microphone,
+			[transcript](const std::string& text, bool final) {
+				if (transcript && !final)
+					transcript->update(text, false);
+			},
+			[&token, deadline]() {
+				return token.cancelled() || std::chrono::steady_clock::now() > deadline;
+			});
+	} catch (const std::exception &e) {
+		if (!transcript)
+			throw;
+		transcript->fail(std::string("voice: ") + e.what());
+		return result;
 	}
+	if (token.cancelled())
+		result.clear();
+	if (!result.empty())
+		result.push_back(' ');
+#endif
+	if (transcript)
+		transcript->update(result, true);
+	return result;
+}
 
-	std::string result = decoded_speech;
+std::shared_ptr<AudioRecord::Transcript> AudioRecord::capture_async(const std::function<void()>& listener)
+{
+	auto transcript = std::make_shared<Transcript>();
+	transcript->set_listener(listener);
+	tasks::Executor::shared().submit(tasks::Priority::HIGH, [transcript](const tasks::Token& token) {
+		capture(transcript.get(), token);
+	}, transcript->token);
+	return transcript;
+}
 
-	ad_close(ad);
-	ps_free(ps);
+// the rendered phrases above the capacity are removed, the least recently played first
+static const uintmax_t AUDIO_CACHE_CAPACITY = 256 * 1024 * 1024;
 
-	return result + " ";
+// QUIZ_SPEECH is a shell command of the speech process,
+// otherwise quiz-speech is taken from the directory of the quiz
+static
+std::vector<std::string> speech_command()
+{
+	if (const char* command = std::getenv("QUIZ_SPEECH"))
+		return { "/bin/sh", "-c", command };
+
+	std::string dir = ".";
+	char path[PATH_MAX];
+	ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+	if (length > 0) {
+		dir.assign(path, length);
+		dir.erase(dir.rfind('/'));
+	}
+
+#ifdef SPD_SAY
+	return { dir + "/quiz-speech", "spd" };
 #else
-	return "";
+	return { dir + "/quiz-speech", "google" };
 #endif
 }
 
+// the audio of the same text differs by the engines, so it's a part of the cache key
 static
-void play_string(std::string s, utils::Language lang)
+std::string speech_engine()
 {
-	try {
-		if (s.empty()) return;
+	if (const char* command = std::getenv("QUIZ_SPEECH"))
+		return command;
 
-		std::list<analysis::Token> tokens = analysis::Analyzer::split_to_tokens(s);
-		std::string expanded;
-		for (const analysis::Token &l : tokens) {
-			if (l.what != analysis::Token::WHAT::WORD)
-				continue;
-
-			std::string word = utils::to_utf8(l.str);
-			if (word == "sb" || word == "smb") word = "somebody";
-			else if (word == "sth" || word == "smth") word = "something";
-			expanded.append(word + ' ');
-		}
-
-		static char audio_play_cmd[100];
 #ifdef SPD_SAY
-		sprintf(audio_play_cmd, "spd-say \"%s\"", expanded.c_str());
-#elif defined GOOGLE_SPEECH
-		utils::Language lan = lang != utils::Language::UNKNOWN
-		                    ? lang
-		                    : utils::what_language(utils::to_utf16(s));
-
-		std::string l;
-		switch(lan)
-		{
-			case (utils::Language::RU) :
-				l = "ru";
-				break;
-			case (utils::Language::NL) :
-				l = "nl";
-				break;
-			case (utils::Language::EN) :
-			default:
-				l = "en";
-				break;
-		}
-
-		sprintf(audio_play_cmd, "google_speech -l %s \"%s\" > /dev/null 2>&1", l.c_str(), expanded.c_str());
+	return "spd";
+#else
+	return "google";
 #endif
-		system(audio_play_cmd);
-	} catch (const std::exception &e) {
-		logging::Error() << "Exception in voice thread: " << e.what() << logging::endl;
+}
+
+static
+speech::AudioCache& audio_cache()
+{
+	namespace fs = std::filesystem;
+
+	fs::path dir;
+	if (const char* cache_home = std::getenv("XDG_CACHE_HOME"))
+		dir = cache_home;
+	else if (const char* home = std::getenv("HOME"))
+		dir = fs::path(home) / ".cache";
+	else
+		dir = fs::temp_directory_path();
+
+	static speech::AudioCache cache(dir / "quiz" / "audio", AUDIO_CACHE_CAPACITY);
+	return cache;
+}
+
+// started by the first phrase, it lives until the exit of the quiz
+static
+speech::Speaker& speaker()
+{
+	static speech::Speaker speaker(speech_command(), tasks::Executor::shared(), &audio_cache(), speech_engine());
+	return speaker;
+}
+
+// the words are spoken without the punctuation, the abbreviations are expanded
+static
+speech::Phrase spoken(const std::string& phrase, utils::Language lang)
+{
+	analysis::Tokens tokens = analysis::Analyzer::split_to_tokens(phrase);
+	std::string expanded;
+	for (const analysis::Token &l : tokens) {
+		if (l.what != analysis::Token::WHAT::WORD)
+			continue;
+
+		std::string word(l.str);
+		if (word == "sb" || word == "smb") word = "somebody";
+		else if (word == "sth" || word == "smth") word = "something";
+		expanded.append(word + ' ');
 	}
+
+	utils::Language language = lang != utils::Language::UNKNOWN ? lang : utils::what_language(phrase);
+	return { expanded, language != utils::Language::UNKNOWN ? language : utils::Language::EN };
+}
+
+void AudioRecord::prepare()
+{
+	speaker();
 }
 
 void AudioRecord::play(const std::string& phrase, utils::Language lang)
 {
-	std::thread t(std::bind(play_string, phrase, lang));
-	t.detach();
+	try {
+		if (phrase.empty()) return;
+
+		speech::Phrase p = spoken(phrase, lang);
+		speaker().say(p.text, p.language);
+	} catch (const std::exception &e) {
+		logging::Error() << "Exception in voice: " << e.what() << logging::endl;
+	}
+}
+
+size_t AudioRecord::prerender(const std::vector<std::pair<std::string, utils::Language>>& phrases, unsigned threads)
+{
+	std::vector<speech::Phrase> spoken_phrases;
+	for (const auto& [phrase, lang]: phrases)
+		if (!phrase.empty())
+			spoken_phrases.push_back(spoken(phrase, lang));
+
+	return speech::prerender(speech_command(), speech_engine(), audio_cache(), spoken_phrases, threads);
+}
+
+// the process is started by the first phrase
+AudioRecord::Warmer::Warmer()
+	: renderer(new speech::Renderer(speech_command(), audio_cache(), speech_engine()))
+{
+}
+
+AudioRecord::Warmer::~Warmer() = default;
+
+void AudioRecord::Warmer::warm(const std::vector<std::pair<std::string, utils::Language>>& phrases,
+	const tasks::Token& token)
+{
+	try {
+		std::string error;
+		for (const auto& [phrase, lang]: phrases)
+			if (!phrase.empty() && !token.cancelled())
+				renderer->render(spoken(phrase, lang), token, error);
+	} catch (const std::exception &) {
+	}
+}
+
+void AudioRecord::Warmer::interrupt()
+{
+	renderer->interrupt();
 }
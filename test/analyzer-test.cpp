@@ -7,64 +7,1101 @@
  *     License: GNU GPL 3
  */
 
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
 #include "gtest/gtest.h"
 
 #include "analyzer.h"
+#include "audio.h"
+#include "editor.h"
+#include "event_loop.h"
+#include "executor.h"
+#include "grader.h"
+#include "headless_screen.h"
+#include "latency.h"
+#include "options.h"
+#include "pattern.h"
 #include "problem.h"
+#include "render.h"
+#include "session.h"
+#include "speech.h"
 #include "utils.h"
+#include "window.h"
 
 namespace {
 
 namespace an = analysis;
 
+Options make_options(std::vector<std::string> flags)
+{
+	flags.insert(flags.begin(), { "quiz", "test.qz" });
+	std::vector<char*> argv;
+	for (std::string& f: flags)
+		argv.push_back(&f[0]);
+
+	Options options;
+	options.parse_arguments(static_cast<int>(argv.size()), argv.data());
+	return options;
+}
+
+Problem make_problem(const std::list<std::string>& question, const std::list<std::string>& solution)
+{
+	return Problem(question, solution, utils::Language::UNKNOWN, utils::Language::UNKNOWN);
+}
+
+// counts the allocations passed to the heap
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+	size_t allocations = 0;
+
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override {
+		++allocations;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+};
+
+std::vector<std::string> editor_lines(const Editor& e)
+{
+	std::vector<std::string> result;
+	for (size_t y = 0; y < e.get_lines_count(); ++y)
+		result.push_back(e.get_line(y).str());
+	return result;
+}
+
+std::string text(const an::Verification& v, const an::Error& e)
+{
+	return std::string(e.text(v.answer[e.line]));
+}
+
 TEST (AnalyzeTest, Spelling)
 {
-	Problem p;
-	p.question = { "Hello world" };
-	p.solution = { "Привет мир" };
+	Problem p = make_problem({ "Hello world" }, { "Привет мир" });
 	std::list<std::string> answer = { "превет" };
 
 	an::Analyzer a;
-	an::Verification v = a.check(p, answer, an::Analyzer::OPTIONS::CASE_UNSENSITIVE);
-	ASSERT_EQ ((size_t)1, v.errors.size());
-
-	std::list<an::Error> le = v.errors.at(0);
-	std::vector<an::Error> e(std::begin(le), std::end(le));
+	an::Verification v = a.check(p, answer, make_options({ "-c" }));
+	const auto& e = v.errors;
 	ASSERT_EQ ((size_t)3, e.size());
 
 	EXPECT_EQ (an::MARK::ERROR | an::MARK::NOT_FULL_ANSWER, v.state);
 
 	EXPECT_EQ (an::Error::WHAT::ERROR_TOKEN, e.at(0).what);
+	EXPECT_EQ ((size_t)0, e.at(0).line);
 	EXPECT_EQ ((size_t)0, e.at(0).pos);
-	EXPECT_EQ ("превет", utils::to_utf8(e.at(0).str));
+	EXPECT_EQ ("превет", text(v, e.at(0)));
 
 	EXPECT_EQ (an::Error::WHAT::ERROR_SYMBOL, e.at(1).what);
 	EXPECT_EQ ((size_t)2, e.at(1).pos);
-	EXPECT_EQ ("е", utils::to_utf8(e.at(1).str));
+	EXPECT_EQ ("е", text(v, e.at(1)));
 
 	EXPECT_EQ (an::Error::WHAT::MISSED, e.at(2).what);
 	EXPECT_EQ ((size_t)6, e.at(2).pos);
-	EXPECT_EQ ("...", utils::to_utf8(e.at(2).str));
+	EXPECT_EQ ("...", text(v, e.at(2)));
 }
 
 TEST (AnalyzeTest, Punctuation)
 {
-	Problem p;
-	p.question = { "Hello, world!" };
-	p.solution = { "Привет, мир!" };
+	Problem p = make_problem({ "Hello, world!" }, { "Привет, мир!" });
 	std::list<std::string> answer = { "Привет мир" };
 
 	an::Analyzer a;
-	an::Verification v = a.check(p, answer, an::Analyzer::OPTIONS::PUNCT_UNSENSITIVE);
+	an::Verification v = a.check(p, answer, make_options({ "-u" }));
 	EXPECT_EQ ((size_t)0, v.errors.size());
 }
 
+TEST (AnalyzeTest, Alternatives)
+{
+	Problem p = make_problem({ "Цвет неба" }, { "the {colour|color} of {the|} sky" });
+
+	an::Analyzer a;
+	Options options = make_options({});
+	EXPECT_EQ (an::MARK::RIGHT, a.check(p, an::AnswerLines{ "the colour of the sky" }, options).state);
+	EXPECT_EQ (an::MARK::RIGHT, a.check(p, an::AnswerLines{ "the color of sky" }, options).state);
+
+	// errors are reported against the closest alternative
+	an::Verification v = a.check(p, an::AnswerLines{ "the colar of sky" }, options);
+	EXPECT_EQ (an::MARK::ERROR, v.state);
+
+	const auto& e = v.errors;
+	ASSERT_EQ ((size_t)2, e.size());
+	EXPECT_EQ (an::Error::WHAT::ERROR_TOKEN, e.at(0).what);
+	EXPECT_EQ ("colar", text(v, e.at(0)));
+	EXPECT_EQ (an::Error::WHAT::ERROR_SYMBOL, e.at(1).what);
+	EXPECT_EQ ((size_t)7, e.at(1).pos);
+	EXPECT_EQ ("a", text(v, e.at(1)));
+
+	v = a.check(p, an::AnswerLines{ "the color sky" }, options);
+	ASSERT_EQ ((size_t)1, v.errors.size());
+	EXPECT_EQ (an::Error::WHAT::MISSED, v.errors.front().what);
+
+	EXPECT_EQ ("the colour of the sky", an::Pattern::plain("the {colour|color} of {the|} sky"));
+	EXPECT_EQ ("if (a) { b(); }", an::Pattern::plain("if (a) { b(); }"));
+}
+
+TEST (AnalyzeTest, BeyondBasicPlane)
+{
+	Problem p = make_problem({ "Smile" }, { "𝄞 улыбка 😀" });
+	std::list<std::string> answer = { "𝄞 улыбкa 😃" };
+
+	an::Analyzer a;
+	an::Verification v = a.check(p, answer, make_options({}));
+
+	const auto& e = v.errors;
+	ASSERT_EQ ((size_t)4, e.size());
+
+	// positions are in code points
+	EXPECT_EQ ((size_t)2, e.at(0).pos);
+	EXPECT_EQ ("a", text(v, e.at(1)));
+	EXPECT_EQ ((size_t)7, e.at(1).pos);
+	EXPECT_EQ ("😃", text(v, e.at(3)));
+	EXPECT_EQ ((size_t)9, e.at(3).pos);
+}
+
+TEST (AnalyzeTest, CaseFolding)
+{
+	// decomposed umlauts in the answer
+	Problem p = make_problem({ "street" }, { "Die STRAẞE, Über, Ёлка" });
+	std::list<std::string> answer = { "die straße, u\u0308ber, е\u0308лка" };
+
+	an::Analyzer a;
+	an::Verification v = a.check(p, answer, make_options({ "-c" }));
+	EXPECT_EQ (an::MARK::RIGHT, v.state);
+	EXPECT_EQ ("die straße, über, ёлка", v.answer.front());
+
+	v = a.check(p, answer, make_options({}));
+	EXPECT_EQ (an::MARK::ERROR, v.state);
+}
+
+TEST (UtilsTest, Utf8)
+{
+	EXPECT_EQ ((size_t)5, utils::utf8_length("a😀бc€"));
+	EXPECT_EQ ((size_t)5, utils::utf8_offset("a😀бc€", 2));
+	EXPECT_EQ (std::u16string(u"a😀бc€"), utils::to_utf16("a😀бc€"));
+	EXPECT_EQ ("a😀бc€", utils::to_utf8(utils::to_utf16("a😀бc€")));
+	EXPECT_EQ (std::u32string(U"a😀бc€"), utils::to_utf32("a😀бc€"));
+
+	std::string long_line(100, 'x');
+	EXPECT_TRUE (utils::is_valid_utf8(long_line + "€" + long_line));
+	EXPECT_FALSE (utils::is_valid_utf8(long_line + "\xE2\x82"));   // truncated
+	EXPECT_FALSE (utils::is_valid_utf8("\xC0\xAF"));                // overlong
+	EXPECT_FALSE (utils::is_valid_utf8("\xED\xA0\x80"));            // surrogate
+	EXPECT_FALSE (utils::is_valid_utf8("\xF4\x90\x80\x80"));        // out of Unicode
+	EXPECT_THROW (utils::to_utf16(long_line + "\xE2\x82"), std::runtime_error);
+}
+
+TEST (UtilsTest, EditDistance)
+{
+	auto distance = [](const std::string& a, const std::string& b, size_t max) {
+		return utils::edit_distance(utils::to_utf32(a), utils::to_utf32(b), max);
+	};
+
+	EXPECT_EQ ((size_t)0, distance("straße", "straße", 2));
+	EXPECT_EQ ((size_t)1, distance("straße", "strase", 2));
+	EXPECT_EQ ((size_t)3, distance("kitten", "sitting", 5));
+	EXPECT_EQ ((size_t)2, distance("", "ab", 5));
+	EXPECT_EQ ((size_t)2, distance("привет", "превед", 5));
+
+	// max + 1 as soon as the distance exceeds max
+	EXPECT_EQ ((size_t)3, distance("kitten", "sitting", 2));
+	EXPECT_EQ ((size_t)2, distance("abc", "abcdefgh", 1));
+
+	// bit-parallel (up to 64 symbols) and plain computations
+	std::string word(70, 'a'), typo = word;
+	typo[10] = 'b';
+	typo[60] = 'c';
+	EXPECT_EQ ((size_t)3, distance(word.substr(0, 64), typo.substr(0, 64) + "d", 5));
+	EXPECT_EQ ((size_t)2, distance(word, typo, 5));
+	EXPECT_EQ ((size_t)2, distance(word, typo, 1));
+}
+
+TEST (UtilsTest, Unicode)
+{
+	std::string s = "ẞ ΣΊΣΥΦΟΣ Ÿ Ї Straße ſ Ǆ";
+	utils::fold_case(s);
+	EXPECT_EQ ("ß σίσυφοσ ÿ ї straße s Ǆ", s);
+
+	s = "A\u030A \u212B e\u0301 и\u0306 i\u0308\u0301";
+	utils::normalize(s);
+	EXPECT_EQ ("Å Å é й ï\u0301", s);
+}
+
+TEST (UtilsTest, Language)
+{
+	EXPECT_EQ (utils::Language::EN, utils::what_language("I would like to reserve a table for two"));
+	EXPECT_EQ (utils::Language::NL, utils::what_language("Ik wil graag een tafel voor twee reserveren"));
+	EXPECT_EQ (utils::Language::DE, utils::what_language("Ich möchte einen Tisch für zwei reservieren"));
+	EXPECT_EQ (utils::Language::FR, utils::what_language("Je voudrais réserver une table pour deux"));
+	EXPECT_EQ (utils::Language::ES, utils::what_language("Quiero reservar una mesa para dos"));
+	EXPECT_EQ (utils::Language::RU, utils::what_language("Я бы хотел заказать столик на двоих"));
+	EXPECT_EQ (utils::Language::UK, utils::what_language("Я хотів би замовити столик на двох"));
+
+	// the letters, which the old ranges missed
+	EXPECT_EQ (utils::Language::RU, utils::what_language("ёлка"));
+	EXPECT_EQ (utils::Language::DE, utils::what_language("Straße"));
+	EXPECT_EQ (utils::Language::UNKNOWN, utils::what_language("42, 😀"));
+
+	EXPECT_EQ (utils::Language::UK, utils::language_by_code("uk"));
+	EXPECT_STREQ ("es", utils::language_code(utils::Language::ES));
 }
 
+TEST (AnalyzeTest, Fuzzy)
+{
+	Problem p = make_problem({ "Я бы хотел заказать столик на двоих" },
+		{ "I would like to reserve a table for two people" });
+	std::list<std::string> answer = { "I would like to reserv a table for two peeple" };
+
+	an::Analyzer a;
+	an::Verification v = a.check(p, answer, make_options({ "-f" }));
+	EXPECT_TRUE (v.right());
+	EXPECT_EQ (an::MARK::NEAR_MISS, v.state);
+	ASSERT_EQ ((size_t)2, v.errors.size());
+	EXPECT_EQ (an::Error::WHAT::NEAR_MISS, v.errors.front().what);
+	EXPECT_EQ ("reserv", text(v, v.errors.front()));
+
+	// one typo in "two" is a third of the word
+	an::AnswerLines typo = { "I would like to reserve a table for tww people" };
+	v = a.check(p, typo, make_options({ "-f", "0.1" }));
+	EXPECT_FALSE (v.right());
+	v = a.check(p, typo, make_options({ "-f", "0.4" }));
+	EXPECT_TRUE (v.right());
+
+	EXPECT_FALSE (a.check(p, answer, make_options({})).right());
+}
+
+TEST (AnalyzeTest, TotalRecall)
+{
+	Problem p = make_problem({ "Verbs followed by a to-infinitive:" },
+		{ "advise to do, afford to do, agree to do,", "arrange to do, ask to do" });
+	std::list<std::string> answer = { "ask to do,  Agree to do", "", "advise to  do, argue to do" };
+
+	an::Analyzer a;
+	an::Verification v = a.check(p, answer, make_options({ "-zc" }));
+	EXPECT_EQ (an::MARK::ERROR, v.state);
+
+	std::vector<std::string_view> expected = {
+		"Wrong:", "argue to do, ", "", "Missed:", "afford to do, arrange to do, " };
+	EXPECT_EQ (expected, std::vector<std::string_view>(v.report.begin(), v.report.end()));
+
+	// the second check uses the interned solution phrases
+	an::AnswerLines right = { "arrange to do. afford to do, agree to do; advise to do,", "ask to do" };
+	v = a.check(p, right, make_options({ "-z" }));
+	EXPECT_EQ (an::MARK::RIGHT, v.state);
+}
+
+TEST (AnalyzeTest, SteadyState)
+{
+	Problem p = make_problem({ "Цвет неба" }, { "The {colour|color} of {the|} sky", "second line" });
+	Options options = make_options({ "-c" });
+	an::Analyzer a;
+	an::AnswerLines answer = { "the colr of sky", "", "second lines here" };
+
+	CountingResource heap;
+	std::pmr::unsynchronized_pool_resource arena(&heap);
+	std::pmr::memory_resource* previous = std::pmr::set_default_resource(&heap);
+
+	// the solution is compiled and the pools of the arena are filled by the first checks
+	for (int i = 0; i < 3; ++i)
+		EXPECT_EQ (an::MARK::ERROR | an::MARK::REDUNDANT_ANSWER, a.check(p, answer, options, &arena).state);
+	EXPECT_NE (0u, heap.allocations);
+
+	heap.allocations = 0;
+	{
+		an::Verification v = a.check(p, answer, options, &arena);
+		EXPECT_FALSE (v.errors.empty());
+	}
+	EXPECT_EQ (0u, heap.allocations);
+
+	std::pmr::set_default_resource(previous);
+}
+
+TEST (AnalyzeTest, LiveCheck)
+{
+	Problem p = make_problem({ "Цвет неба" }, { "The {colour|color} of {the|} sky" });
+	Options options = make_options({ "-c" });
+	an::Analyzer a;
+	an::LiveCheck live(a, p, options);
+
+	auto errors = [](const std::vector<an::Error>& errors, std::string_view line) {
+		std::vector<std::pair<std::string, size_t>> result;
+		for (const an::Error& e: errors)
+			result.push_back({ std::string(e.text(line)), e.pos });
+		return result;
+	};
+
+	// every edit gives the same errors as a check from scratch
+	std::string typed;
+	for (char c: std::string("the Colr of sky")) {
+		typed.push_back(c);
+		an::LiveCheck scratch(a, p, options);
+		EXPECT_EQ (errors(scratch.update(0, typed), typed), errors(live.update(0, typed), typed));
+	}
+
+	std::vector<std::pair<std::string, size_t>> expected = { { "Colr", 4 } };
+	EXPECT_EQ (expected, errors(live.update(0, typed), typed));
+
+	// the last token may be typed not completely
+	EXPECT_TRUE (live.update(0, "the colo").empty());
+	expected = { { "colx", 4 } };
+	EXPECT_EQ (expected, errors(live.update(0, "the colx"), "the colx"));
+	EXPECT_TRUE (live.update(0, "the color of the sky").empty());
+
+	// lines out of the solution are not checked
+	EXPECT_TRUE (live.update(1, "more").empty());
+
+	// empty lines are skipped as by the verification
+	Problem two = make_problem({ "a", "b" }, { "a", "b" });
+	an::LiveCheck lines(a, two, options);
+	EXPECT_TRUE (lines.update(0, "").empty());
+	EXPECT_TRUE (lines.update(1, "a").empty());
+	EXPECT_TRUE (lines.update(2, "b").empty());
+	EXPECT_EQ (an::MARK::RIGHT, a.check(two, std::list<std::string>{ "", "a", "b" }, options).state);
+
+	// a line getting not empty shifts the lines after it
+	EXPECT_TRUE (lines.update(0, "a").empty());
+	expected = { { "a", 0 } };
+	EXPECT_EQ (expected, errors(lines.update(1, "a"), "a"));
+	EXPECT_TRUE (lines.update(2, "b").empty()); // out of the solution now
+	EXPECT_TRUE (lines.update(0, "").empty());
+	EXPECT_TRUE (lines.update(1, "a").empty());
+}
+
+TEST (AnalyzeTest, Batch)
+{
+	std::vector<std::shared_ptr<Problem>> problems = {
+		std::make_shared<Problem>(make_problem({ "yes, exactly" }, { "ja, genau" })),
+		std::make_shared<Problem>(make_problem({ "good morning" }, { "{guten|} Morgen" }))
+	};
+	std::vector<std::list<std::string>> answers = {
+		{ "ja, genau" }, { "ja genau" }, { "Morgen" }, { "guten Morgen" }, { "gute Morgen" }, { "ja, genau", "ja" }
+	};
+
+	size_t answer_problem[] = { 0, 0, 1, 1, 1, 0 };
+
+	std::vector<an::Submission> submissions;
+	for (size_t i = 0; i < 1000; ++i)
+		submissions.push_back({ problems[answer_problem[i % 6]].get(), answers[i % 6] });
+
+	Options options = make_options({});
+	an::Analyzer a;
+	std::vector<an::Verification> results = a.check(submissions, options, 4);
+	ASSERT_EQ (submissions.size(), results.size());
+	for (size_t i = 0; i < submissions.size(); ++i) {
+		an::Verification v = a.check(*submissions[i].problem, submissions[i].answer, options);
+		EXPECT_EQ (v.state, results[i].state);
+		EXPECT_EQ (v.errors.size(), results[i].errors.size());
+	}
+
+	std::istringstream in(
+		"{\"problem\": 0, \"answer\": [\"ja genau\"]}\n"
+		"\n"
+		"{\"question\": \"good morning\", \"id\": {\"a\": [1, 2]}, \"answer\": \"Morgen\"}\n"
+		"{\"problem\": 7, \"answer\": []}\n");
+	std::ostringstream out;
+	EXPECT_EQ (1u, grading::grade(problems, options, in, out));
+	EXPECT_EQ (
+		"{\"line\": 1, \"problem\": 0, \"state\": 8, \"right\": false, \"errors\": "
+			"[{\"line\": 0, \"what\": \"missed\", \"str\": \" \", \"pos\": 2}]}\n"
+		"{\"line\": 3, \"problem\": 1, \"state\": 0, \"right\": true, \"errors\": []}\n"
+		"{\"line\": 4, \"error\": \"unknown problem\"}\n", out.str());
+}
+
+TEST (AnalyzeTest, GradeNumbers)
+{
+	std::vector<std::shared_ptr<Problem>> problems = {
+		std::make_shared<Problem>(make_problem({ "yes" }, { "ja" })),
+		std::make_shared<Problem>(make_problem({ "no" }, { "nein" }))
+	};
+
+	std::istringstream in(
+		"{\"problem\": 1, \"answer\": \"nein\"}\n"
+		"{\"problem\": -, \"answer\": \"ja\"}\n"
+		"{\"problem\": 1-2, \"answer\": \"ja\"}\n"
+		"{\"problem\": --1, \"answer\": \"ja\"}\n"
+		"{\"problem\": 99999999999999999999, \"answer\": \"ja\"}\n"
+		"{\"problem\": -1, \"answer\": \"ja\"}\n");
+	std::ostringstream out;
+	EXPECT_EQ (5u, grading::grade(problems, make_options({}), in, out));
+	EXPECT_EQ (
+		"{\"line\": 1, \"problem\": 1, \"state\": 0, \"right\": true, \"errors\": []}\n"
+		"{\"line\": 2, \"error\": \"expected a number\"}\n"
+		"{\"line\": 3, \"error\": \"invalid number\"}\n"
+		"{\"line\": 4, \"error\": \"expected a number\"}\n"
+		"{\"line\": 5, \"error\": \"number out of range\"}\n"
+		"{\"line\": 6, \"error\": \"unknown problem\"}\n", out.str());
+}
+
+TEST (AnalyzeTest, GradeInverted)
+{
+	// the lines of a question are not concatenated: { "ab", "c" } is not { "a", "bc" }
+	std::vector<std::shared_ptr<Problem>> problems = {
+		std::make_shared<Problem>(make_problem({ "ab", "c" }, { "first" })),
+		std::make_shared<Problem>(make_problem({ "a", "bc" }, { "second" }))
+	};
+
+	std::istringstream in(
+		"{\"question\": [\"a\", \"bc\"], \"answer\": \"second\"}\n");
+	std::ostringstream out;
+	EXPECT_EQ (0u, grading::grade(problems, make_options({}), in, out));
+	EXPECT_EQ ("{\"line\": 1, \"problem\": 1, \"state\": 0, \"right\": true, \"errors\": []}\n", out.str());
+
+	// with -i the question is the solution of the quiz
+	std::istringstream inverted(
+		"{\"question\": \"first\", \"answer\": [\"ab\", \"c\"]}\n"
+		"{\"problem\": 1, \"answer\": \"second\"}\n");
+	out.str("");
+	EXPECT_EQ (0u, grading::grade(problems, make_options({ "-i" }), inverted, out));
+	std::string graded = out.str();
+	EXPECT_EQ (0u, graded.find("{\"line\": 1, \"problem\": 0, \"state\": 0, \"right\": true, \"errors\": []}\n"));
+	EXPECT_NE (std::string::npos, graded.find("{\"line\": 2, \"problem\": 1, \"state\": 8, \"right\": false"));
+}
+
+TEST (AnalyzeTest, SolutionCache)
+{
+	an::Analyzer a;
+	Options options = make_options({});
+	{
+		Problem p = make_problem({ "question" }, { "first" });
+		EXPECT_EQ (an::MARK::RIGHT, a.check(p, std::list<std::string>{ "first" }, options).state);
+	}
+	// the lines of a new problem may take the memory of the freed ones
+	Problem p = make_problem({ "question" }, { "second" });
+	EXPECT_EQ (an::MARK::RIGHT, a.check(p, std::list<std::string>{ "second" }, options).state);
+	EXPECT_EQ (an::MARK::ERROR, a.check(p, std::list<std::string>{ "first" }, options).state);
+
+	EXPECT_NE (utils::hash_lines({ "ab", "c" }), utils::hash_lines({ "a", "bc" }));
+	EXPECT_NE (utils::hash_lines({ "a" }), utils::hash_lines({ "a", "" }));
+}
+
+TEST (EditorTest, GapBuffer)
+{
+	GapBuffer b("hello world");
+	b.insert(5, ",");
+	b.insert(0, "> ");
+	b.erase(12, 5);
+	EXPECT_EQ (b.str(), "> hello, wor");
+	EXPECT_EQ (b.substr(4, 6), "llo, w");
+	EXPECT_EQ (b.size(), 12u);
+
+	// the typing goes on at one place, the text after it stays
+	GapBuffer line("[]");
+	std::string expected;
+	for (int i = 0; i < 2000; ++i) {
+		line.insert(1 + expected.size(), i % 2 ? "ж" : "z");
+		expected += i % 2 ? "ж" : "z";
+	}
+	EXPECT_EQ (line.str(), "[" + expected + "]");
+
+	size_t pos = 2;
+	EXPECT_EQ (line.code_point(pos), U'ж');
+	EXPECT_EQ (pos, 4u);
+	EXPECT_EQ (line.previous(4), 2u);
+	EXPECT_EQ (line.previous(2), 1u);
+}
+
+TEST (EditorTest, Widths)
+{
+	std::string locale = setlocale(LC_CTYPE, nullptr);
+	setlocale(LC_CTYPE, "C.UTF-8");
+
+	Editor e(4);
+	for (char32_t c: std::u32string(U"a€„漢"))
+		e.add_ch(c);
+	EXPECT_EQ (e.get_current_line().str(), "a€„漢");
+	EXPECT_EQ (e.get_screen_x(), 5u);
+
+	e.left();
+	EXPECT_EQ (e.get_cursor_x(), 7u);
+	EXPECT_EQ (e.get_screen_x(), 3u);
+	e.backspace();
+	EXPECT_EQ (e.get_current_line().str(), "a€漢");
+	EXPECT_EQ (e.get_screen_x(), 2u);
+
+	e.add_ch(U'\t');
+	EXPECT_EQ (e.get_screen_x(), 4u);
+	e.left();
+	e.right();
+	EXPECT_EQ (e.get_screen_x(), 4u);
+	e.del();
+	EXPECT_EQ (e.get_current_line().str(), "a€\t");
+
+	// the cursor keeps its column on the other lines
+	e.new_line();
+	e.add_str("漢字漢字");
+	e.home();
+	e.right();
+	EXPECT_EQ (e.get_screen_x(), 2u);
+	e.up();
+	EXPECT_EQ (e.get_cursor_x(), 4u);
+	EXPECT_EQ (e.get_screen_x(), 2u);
+	e.down();
+	e.right();
+	e.up();
+	EXPECT_EQ (e.get_cursor_x(), 5u);
+	EXPECT_EQ (e.get_screen_x(), 4u);
+
+	e.page_down();
+	e.home();
+	e.backspace();
+	EXPECT_EQ (editor_lines(e), std::vector<std::string>{ "a€\t漢字漢字" });
+	EXPECT_EQ (e.get_screen_x(), 4u);
+
+	// the columns of the error overlays are the ones of the cursor
+	EXPECT_EQ (advance_column(0, U'漢', 4), 2u);
+	EXPECT_EQ (advance_column(2, U'\t', 4), 4u);
+	EXPECT_EQ (advance_column(4, U'\x01', 4), 6u);
+
+	setlocale(LC_CTYPE, locale.c_str());
+}
+
+TEST (EditorTest, Paste)
+{
+	Editor e(4);
+	e.add_str("[]");
+	e.left();
+	EXPECT_FALSE (e.add_str("one"));
+	EXPECT_TRUE (e.add_str(" two\nthree\n\nfour "));
+	EXPECT_EQ (editor_lines(e), (std::vector<std::string>{ "[one two", "three", "", "four ]" }));
+	EXPECT_EQ (e.get_screen_y(), 3u);
+	EXPECT_EQ (e.get_cursor_x(), 5u);
+}
+
+TEST (EditorTest, Typing)
+{
+	// the typing in the middle of a long line moves neither side of it
+	Editor e(4);
+	e.add_str(std::string(2000, 'x'));
+	e.home();
+	for (int i = 0; i < 1000; ++i)
+		e.right();
+	e.add_ch(U'[');
+
+	const GapBuffer& line = e.get_current_line();
+	const char* head = line.before().data();
+	const char* tail = line.after().data();
+	for (int i = 0; i < 40; ++i)
+		e.add_ch(i % 2 ? U'ж' : U'z');
+	e.add_ch(U']');
+
+	EXPECT_EQ (head, line.before().data());
+	EXPECT_EQ (tail, line.after().data());
+	EXPECT_EQ (1000u, line.after().size());
+	EXPECT_EQ (e.get_cursor_x(), line.before().size());
+
+	std::string typed;
+	for (int i = 0; i < 40; ++i)
+		typed += i % 2 ? "ж" : "z";
+	EXPECT_EQ (std::string(1000, 'x') + "[" + typed + "]" + std::string(1000, 'x'), std::string(e.get_text(0)));
+}
+
+TEST (ViewTest, Viewport)
+{
+	view::ncurses::Viewport v;
+	v.set_rows(3);
+	v.set_lines(10);
+	EXPECT_TRUE (v.clipped());
+	EXPECT_EQ (0u, v.begin());
+	EXPECT_EQ (3u, v.end());
+
+	// a page leaves one line of the previous one
+	v.page(1);
+	EXPECT_EQ (2u, v.begin());
+	v.page(-1);
+	EXPECT_EQ (0u, v.begin());
+
+	// the offset is kept inside the content
+	v.scroll_by(-5);
+	EXPECT_EQ (0u, v.begin());
+	v.scroll_by(100);
+	EXPECT_EQ (7u, v.begin());
+	EXPECT_EQ (10u, v.end());
+	v.set_lines(5);
+	EXPECT_EQ (2u, v.begin());
+	EXPECT_EQ (5u, v.end());
+	v.set_lines(2);
+	EXPECT_EQ (0u, v.begin());
+	EXPECT_EQ (2u, v.end());
+	EXPECT_FALSE (v.clipped());
+
+	// the line is scrolled to the nearest edge
+	v.set_lines(10);
+	v.show(6);
+	EXPECT_EQ (4u, v.begin());
+	EXPECT_TRUE (v.visible(6));
+	v.show(1);
+	EXPECT_EQ (1u, v.begin());
+	v.show(2);
+	EXPECT_EQ (1u, v.begin());
+}
+
+TEST (ViewTest, Keys)
+{
+	namespace nc = view::ncurses;
+
+	// ncurses on a pseudo terminal, the keys are pushed back to its input
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+	ASSERT_GE (master, 0);
+	ASSERT_EQ (0, grantpt(master));
+	ASSERT_EQ (0, unlockpt(master));
+	FILE* terminal = fopen(ptsname(master), "r+");
+	ASSERT_NE (nullptr, terminal);
+	SCREEN* screen = newterm("xterm", terminal, terminal);
+	ASSERT_NE (nullptr, screen);
+
+	{
+		tasks::EventLoop loop;
+		int resizes = 0;
+		nc::CursorWindow window(loop, [&resizes]() { ++resizes; });
+		window.resize({ 0, 0, 80, 24 });
+
+		// a burst of resizes is laid out once, the key after it is kept
+		ungetch(KEY_F(2));
+		for (int i = 0; i < 3; ++i)
+			ungetch(KEY_RESIZE);
+		EXPECT_TRUE (window.get_key(0).is(KEY_F(2)));
+		EXPECT_EQ (1, resizes);
+
+		// an empty paste is no key
+		ungetch(nc::KEY_PASTE_END);
+		ungetch(nc::KEY_PASTE_BEGIN);
+		EXPECT_TRUE (window.get_key(0).none());
+	}
+
+	endwin();
+	delscreen(screen);
+	fclose(terminal);
+	close(master);
+}
+
+TEST (SessionTest, Headless)
+{
+	namespace fs = std::filesystem;
+	namespace hl = view::headless;
+
+	fs::path file = fs::path(testing::TempDir()) / "quiz-session-test.qz";
+	fs::path stat = file.parent_path() / ".quiz-session-test.stat";
+	fs::remove(stat);
+
+	// the same solution, the order of the problems doesn't matter
+	std::vector<std::shared_ptr<Problem>> problems = {
+		std::make_shared<Problem>(make_problem({ "yes" }, { "ja" })),
+		std::make_shared<Problem>(make_problem({ "yes, sure" }, { "ja" })),
+	};
+
+	hl::HeadlessScreen screen(false, 24, 120);
+	screen.type("ja");
+	screen.press(hl::Input::Key::F2);
+	screen.type("n");
+	screen.type("nein");
+	screen.press(hl::Input::Key::F2);
+	screen.type("n");
+	screen.press(hl::Input::Key::F3);
+	screen.type("n");
+
+	std::vector<std::string> played;
+	{
+		session::StatisticSaver saver(file.string());
+		session::run(problems, make_options({}), screen, saver,
+			[&played](const std::string& phrase, utils::Language) { played.push_back(phrase); }, 1);
+	}
+
+	EXPECT_TRUE (screen.script_done());
+	EXPECT_TRUE (screen.shows("All problems are solved"));
+	EXPECT_TRUE (screen.shows("Left:[0]; Solved:[1]; Errors:[1]"));
+	EXPECT_EQ (screen.row(23).substr(0, 5), " All ");
+	EXPECT_EQ (screen.key_latencies().size(), 6u);
+	EXPECT_GT (screen.frames(), 10u);
+	EXPECT_TRUE (played.empty());
+
+	EXPECT_EQ (problems[0]->total_errors + problems[1]->total_errors, 1);
+	EXPECT_TRUE (fs::exists(stat));
+	fs::remove(stat);
+}
+
+TEST (SessionTest, Lookahead)
+{
+	namespace fs = std::filesystem;
+	namespace hl = view::headless;
+
+	fs::path file = fs::path(testing::TempDir()) / "quiz-lookahead-test.qz";
+	fs::path stat = file.parent_path() / ".quiz-lookahead-test.stat";
+
+	std::vector<std::shared_ptr<Problem>> problems = {
+		std::make_shared<Problem>(make_problem({ "alpha" }, { "ja" })),
+		std::make_shared<Problem>(make_problem({ "bravo" }, { "ja" })),
+		std::make_shared<Problem>(make_problem({ "charlie" }, { "ja" })),
+	};
+
+	// two problems are solved at once, the last one is wrong and repeated twice
+	hl::HeadlessScreen screen(false, 24, 120);
+	for (const char* answer: { "ja", "ja", "nein", "ja", "ja" }) {
+		screen.type(answer);
+		screen.press(hl::Input::Key::F2);
+		screen.type("n");
+	}
+
+	// the phrases are warmed until the cancel, then the phrase being rendered takes a while,
+	// unless it's interrupted
+	std::atomic<int> warms(0), warming(0);
+	std::atomic<bool> interrupted(false);
+	session::Warmer warmer = {
+		[&](const std::vector<std::pair<std::string, utils::Language>>&, const tasks::Token& token) {
+			++warms;
+			++warming;
+			while (!token.cancelled())
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			auto rendered = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+			while (!interrupted && std::chrono::steady_clock::now() < rendered)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			--warming;
+		},
+		[&]() { interrupted = true; }
+	};
+
+	// the question is played from the prepared phrases, they have to be of the problem shown
+	std::vector<std::string> played;
+	size_t not_shown = 0;
+	{
+		session::StatisticSaver saver(file.string());
+		session::run(problems, make_options({ "-w" }), screen, saver,
+			[&](std::string phrase, utils::Language) {
+				utils::trim_spaces(phrase);
+				played.push_back(phrase);
+				if (!screen.shows(phrase))
+					++not_shown;
+			}, 7, warmer);
+	}
+
+	// no warm is left running after the session
+	EXPECT_TRUE (interrupted);
+	EXPECT_LT (0, warms.load());
+	EXPECT_EQ (0, warming.load());
+
+	EXPECT_TRUE (screen.script_done());
+	EXPECT_TRUE (screen.shows("All problems are solved"));
+	EXPECT_EQ (0u, not_shown);
+
+	// the solved ones are not chosen again, the last one is looked ahead while it's answered
+	ASSERT_EQ (5u, played.size());
+	std::set<std::string> first(played.begin(), played.begin() + 3);
+	EXPECT_EQ ((std::set<std::string>{ "alpha", "bravo", "charlie" }), first);
+	EXPECT_EQ (played[2], played[3]);
+	EXPECT_EQ (played[2], played[4]);
+	fs::remove(stat);
+}
+
+TEST (AudioTest, RingBuffer)
+{
+	audio::RingBuffer ring(3);
+	std::vector<int16_t> samples = { 1, 2, 3, 4, 5 }, drained;
+	ring.push(samples.data(), 2);
+	ring.push(samples.data() + 2, 3);
+	EXPECT_EQ (3u, ring.size());
+	ring.drain(drained);
+	EXPECT_EQ (std::vector<int16_t>({ 3, 4, 5 }), drained);
+	EXPECT_EQ (0u, ring.size());
+}
+
+TEST (AudioTest, WavSourceAndVoiceGate)
+{
+	// a second of silence, then a voice
+	const int RATE = 16000;
+	std::vector<int16_t> samples(RATE, 0);
+	for (int i = 0; i < RATE / 2; ++i)
+		samples.push_back(i % 2 ? 3000 : -3000);
+
+	std::string path = testing::TempDir() + "quiz-audio-test.wav";
+	audio::write_wav(path, samples, RATE);
+
+	audio::WavSource source(path);
+	EXPECT_EQ (RATE, source.sample_rate());
+
+	// the gate opens by the block with the voice, the pre-roll is passed before it
+	const size_t BLOCK = 1024;
+	audio::VoiceGate gate(RATE, 300);
+	std::vector<int16_t> block(BLOCK), read, passed;
+	size_t n, first_passed = 0;
+	while ((n = source.read(block.data(), BLOCK)) > 0) {
+		read.insert(read.end(), block.begin(), block.begin() + n);
+		const std::vector<int16_t>& voice = gate.feed(block.data(), n);
+		if (passed.empty() && !voice.empty())
+			first_passed = voice.size();
+		passed.insert(passed.end(), voice.begin(), voice.end());
+	}
+
+	EXPECT_EQ (samples, read);
+	EXPECT_TRUE (gate.open());
+	EXPECT_EQ (RATE * 300 / 1000 + BLOCK, first_passed);
+	EXPECT_TRUE (std::equal(passed.rbegin(), passed.rend(), samples.rbegin()));
+
+	std::remove(path.c_str());
+	EXPECT_THROW (audio::WavSource(testing::TempDir() + "quiz-no-such.wav"), std::runtime_error);
+}
+
+TEST (ExecutorTest, Priorities)
+{
+	tasks::Executor executor(1);
+	EXPECT_EQ (1u, executor.threads());
+
+	// the worker is busy until the tasks are queued
+	std::promise<void> queued;
+	std::shared_future<void> ready = queued.get_future().share();
+	executor.submit(tasks::Priority::LOW, [ready](const tasks::Token&) { ready.wait(); });
+
+	std::string order;
+	executor.submit(tasks::Priority::LOW, [&order](const tasks::Token&) { order += "low "; });
+	executor.submit(tasks::Priority::NORMAL, [&order](const tasks::Token&) { order += "normal "; });
+	executor.submit(tasks::Priority::HIGH, [&order](const tasks::Token&) { order += "high "; });
+	tasks::Token superseded = executor.submit(tasks::Priority::HIGH, [&order](const tasks::Token&) { order += "superseded "; });
+	superseded.cancel();
+
+	queued.set_value();
+	executor.wait();
+	EXPECT_EQ ("high normal low ", order);
+	EXPECT_TRUE (superseded.done());
+}
+
+TEST (EventLoopTest, TimersPostsAndInput)
+{
+	tasks::EventLoop loop;
+	int fds[2];
+	ASSERT_EQ (0, pipe(fds));
+
+	EXPECT_EQ (tasks::EventLoop::Wake::TIMEOUT, loop.wait(fds[0], 0));
+
+	// the once timer is removed after its run, the periodic one ticks until it's removed
+	int once = 0, ticks = 0;
+	loop.add_timer(std::chrono::milliseconds(0), std::chrono::milliseconds(0), [&once]() { ++once; });
+	int periodic = loop.add_timer(std::chrono::milliseconds(5), std::chrono::milliseconds(5), [&ticks]() { ++ticks; });
+	while (ticks < 3)
+		EXPECT_EQ (tasks::EventLoop::Wake::EVENT, loop.wait(fds[0], 1000));
+	loop.remove_timer(periodic);
+	EXPECT_EQ (1, once);
+	EXPECT_EQ (tasks::EventLoop::Wake::TIMEOUT, loop.wait(fds[0], 20));
+
+	// a completion of another thread runs on the thread of the loop
+	std::thread::id ran_on;
+	std::thread worker([&loop, &ran_on]() {
+		loop.post([&ran_on]() { ran_on = std::this_thread::get_id(); });
+	});
+	worker.join();
+	EXPECT_EQ (tasks::EventLoop::Wake::EVENT, loop.wait(fds[0], 1000));
+	EXPECT_EQ (std::this_thread::get_id(), ran_on);
+
+	ASSERT_EQ (1, write(fds[1], "x", 1));
+	EXPECT_EQ (tasks::EventLoop::Wake::READABLE, loop.wait(fds[0]));
+
+	close(fds[0]);
+	close(fds[1]);
+}
+
+TEST (LatencyTest, Histogram)
+{
+	using ns = std::chrono::nanoseconds;
+	// the buckets are continuous, a value is in the bucket of its lower bound
+	for (uint64_t v: { 0ull, 7ull, 8ull, 15ull, 16ull, 1000ull, 123456789ull, ~0ull }) {
+		int b = latency::Histogram::bucket(v);
+		EXPECT_LE (latency::Histogram::lower_bound(b), v);
+		if (b + 1 < latency::Histogram::BUCKETS) {
+			EXPECT_GT (latency::Histogram::lower_bound(b + 1), v);
+		}
+	}
+
+	latency::Histogram h;
+	for (int i = 1; i <= 100; ++i)
+		h.record(ns(i * 1000));
+	EXPECT_EQ (100u, h.count());
+	EXPECT_EQ (ns(100000), h.max());
+	EXPECT_EQ (ns(50500), h.mean());
+	// within the share of a sub-bucket
+	EXPECT_NEAR (50000, h.percentile(0.5).count(), 50000 / 8);
+	EXPECT_NEAR (99000, h.percentile(0.99).count(), 99000 / 8);
+
+	std::ostringstream os;
+	h.write(os, "key");
+	EXPECT_EQ (0u, os.str().find("key: 100 events, mean 50.5 us"));
+	EXPECT_FALSE (latency::enabled());
+}
+
+TEST (SpeechTest, Speaker)
+{
+	// the fake speech process writes the requests to a file, every phrase takes 'delay' seconds
+	std::string spoken = testing::TempDir() + "quiz-speech-test";
+	auto fake = [&spoken](const char* delay) {
+		std::remove(spoken.c_str());
+		return std::vector<std::string>{ "/bin/sh", "-c",
+			std::string("while IFS= read -r line; do sleep ") + delay
+				+ "; printf '%s\\n' \"$line\" >> " + spoken + "; echo ok; done" };
+	};
+	auto lines = [&spoken]() {
+		std::ifstream in(spoken);
+		std::vector<std::string> result;
+		for (std::string line; std::getline(in, line); )
+			result.push_back(line);
+		return result;
+	};
+
+	tasks::Executor executor(2);
+
+	{
+		speech::Speaker speaker(fake("0"), executor);
+		speaker.say("erste\nZeile", utils::Language::DE);
+		speaker.wait();
+		speaker.say("second", utils::Language::EN);
+		speaker.wait();
+		std::vector<std::string> expected = { "say\tde\terste Zeile", "say\ten\tsecond" };
+		EXPECT_EQ (expected, lines());
+	}
+
+	{
+		// the phrase being spoken is interrupted and the waiting one is dropped;
+		// the process doesn't know the stop request, it's killed
+		speech::Speaker speaker(fake("1"), executor);
+		speaker.say("one", utils::Language::EN);
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		speaker.say("two", utils::Language::EN);
+		speaker.say("three", utils::Language::EN);
+		speaker.wait();
+		std::vector<std::string> expected = { "say\ten\tthree" };
+		EXPECT_EQ (expected, lines());
+	}
+
+	{
+		// the phrase is spoken by a child of the process, the stop request kills it and the process
+		// goes on, it's not restarted
+		std::remove(spoken.c_str());
+		speech::Speaker speaker({ "/bin/sh", "-c", "echo start >> " + spoken
+			+ "; while IFS= read -r line; do if [ \"$line\" = stop ]; then kill $p 2>/dev/null && echo stopped; echo ok;"
+			+ " else (sleep 0.5; printf '%s\\n' \"$line\" >> " + spoken + "; echo ok) & p=$!; fi; done" }, executor);
+		speaker.say("one", utils::Language::EN);
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		auto start = std::chrono::steady_clock::now();
+		speaker.say("two", utils::Language::EN);
+		speaker.wait();
+		EXPECT_LT (std::chrono::steady_clock::now() - start, std::chrono::milliseconds(900));
+		std::vector<std::string> expected = { "start", "say\ten\ttwo" };
+		EXPECT_EQ (expected, lines());
+	}
+
+	{
+		// the process is restarted after its exit
+		speech::Speaker speaker({ "/bin/sh", "-c", "read -r line; printf '%s\\n' \"$line\" >> " + spoken + "; echo ok" }, executor);
+		std::remove(spoken.c_str());
+		speaker.say("first", utils::Language::RU);
+		speaker.wait();
+		speaker.say("again", utils::Language::RU);
+		speaker.wait();
+		std::vector<std::string> expected = { "say\tru\tfirst", "say\tru\tagain" };
+		EXPECT_EQ (expected, lines());
+	}
+}
+
+TEST (SpeechTest, AudioCache)
+{
+	namespace fs = std::filesystem;
+
+	fs::path dir = fs::path(testing::TempDir()) / "quiz-audio-cache-test";
+	fs::remove_all(dir);
+
+	// the fake speech process writes 100 bytes to the file of the request
+	std::string requests = testing::TempDir() + "quiz-audio-requests-test";
+	std::remove(requests.c_str());
+	std::vector<std::string> fake = { "/bin/sh", "-c",
+		"while IFS= read -r line; do printf '%s\\n' \"$line\" >> " + requests
+			+ "; file=$(printf '%s' \"$line\" | cut -f4); [ -e \"$file\" ] || head -c 100 /dev/zero > \"$file\"; echo ok; done" };
+
+	std::vector<speech::Phrase> phrases = {
+		{ "one", utils::Language::EN },
+		{ "two", utils::Language::EN },
+		{ "three", utils::Language::EN },
+		{ "one", utils::Language::EN }
+	};
+
+	{
+		speech::AudioCache cache(dir, 1000);
+		fs::path one = cache.file("one", utils::Language::EN, "fake");
+		EXPECT_EQ (one, cache.file("one", utils::Language::EN, "fake"));
+		EXPECT_NE (one, cache.file("one", utils::Language::NL, "fake"));
+		EXPECT_NE (one, cache.file("one", utils::Language::EN, "other"));
+
+		EXPECT_EQ (3u, speech::prerender(fake, "fake", cache, phrases, 2));
+		EXPECT_TRUE (cache.use(one));
+		// warm cache
+		EXPECT_EQ (0u, speech::prerender(fake, "fake", cache, phrases, 2));
+
+		// played from the cache
+		std::remove(requests.c_str());
+		{
+			tasks::Executor executor(1);
+			speech::Speaker speaker(fake, executor, &cache, "fake");
+			speaker.say("one", utils::Language::EN);
+			speaker.wait();
+		}
+		std::ifstream in(requests);
+		std::string line;
+		std::getline(in, line);
+		EXPECT_EQ ("play\ten\tone\t" + one.string(), line);
+	}
+
+	{
+		// the least recently used files are removed above the capacity
+		speech::AudioCache cache(dir, 1000);
+		auto now = fs::file_time_type::clock::now();
+		fs::last_write_time(cache.file("two", utils::Language::EN, "fake"), now - std::chrono::hours(2));
+		fs::last_write_time(cache.file("three", utils::Language::EN, "fake"), now - std::chrono::hours(3));
+	}
+
+	speech::AudioCache cache(dir, 280);
+	EXPECT_TRUE (cache.use(cache.file("one", utils::Language::EN, "fake")));
+	EXPECT_TRUE (cache.use(cache.file("two", utils::Language::EN, "fake")));
+	EXPECT_FALSE (cache.use(cache.file("three", utils::Language::EN, "fake")));
+
+	{
+		// the phrase being rendered is interrupted by the cancel of its token only
+		speech::Renderer renderer({ "/bin/sh", "-c", "while IFS= read -r line; do sleep 5; echo ok; done" }, cache, "fake");
+		tasks::Token token;
+		std::string error;
+		auto start = std::chrono::steady_clock::now();
+		std::thread rendering([&]() { EXPECT_FALSE (renderer.render({ "three", utils::Language::EN }, token, error)); });
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		renderer.interrupt();
+		token.cancel();
+		renderer.interrupt();
+		rendering.join();
+		EXPECT_LT (std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+	}
+
+	fs::remove_all(dir);
+}
+
+} // namespace
+
 int main(int argc, char* argv[])
 {
 	setlocale(LC_ALL, "");
+	// the wide characters are classified in a utf8 locale only, the environment may have none
+	if (MB_CUR_MAX == 1)
+		setlocale(LC_CTYPE, "C.UTF-8");
 	testing::InitGoogleTest(&argc, argv);
 	return RUN_ALL_TESTS();
 }